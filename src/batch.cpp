@@ -0,0 +1,191 @@
+#include "batch.hpp"
+#include "suffixsort.hpp"
+#include "scheduler.hpp"
+#include "memory.hpp"
+#include "tupla.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <boost/format.hpp>
+
+using namespace tupla;
+
+tupla::batchsort::batchsort(const uint32 jobs, std::ostream& err,
+		const sortopts& opts, const batchopts& bopts)
+	: jobs(jobs), err(err), opts(opts), bopts(bopts)
+{
+}
+
+tupla::batchsort::~batchsort()
+{
+}
+
+std::vector<std::string> tupla::batchsort::list_inputs(
+		const std::string& name)
+{
+	std::vector<std::string> inputs;
+
+	// Regular files in directory, except outputs
+	DIR * dir = opendir(name.c_str());
+	if (dir != 0) {
+		std::string rank_suffix = std::string(".") + RankFileSuffix;
+		std::string lcp_suffix = std::string(".") + LCPFileSuffix;
+		auto has_suffix = [](const std::string& s, const std::string& suffix) {
+			return (s.size() >= suffix.size() 
+					&& s.compare(s.size() - suffix.size(), suffix.size(), 
+					suffix) == 0);
+		};
+
+		for (struct dirent * e = readdir(dir) ; e != 0 ; e = readdir(dir)) {
+			std::string path = name + "/" + e->d_name;
+			struct stat stat_buf;
+			if (stat(path.c_str(), &stat_buf) != 0 
+					|| !S_ISREG(stat_buf.st_mode)) continue;
+			if (has_suffix(path, rank_suffix) || has_suffix(path, lcp_suffix))
+				continue;
+			inputs.push_back(path);
+		}
+		closedir(dir);
+		std::sort(inputs.begin(), inputs.end());
+		return inputs;
+	}
+
+	// File names listed one per line
+	std::ifstream list(name.c_str());
+	if (!list.is_open()) {
+		throw std::runtime_error("could not open batch input list");
+	}
+	std::string line;
+	while (std::getline(list, line)) {
+		if (!line.empty()) inputs.push_back(line);
+	}
+	return inputs;
+}
+
+size_t tupla::batchsort::run(const std::vector<std::string>& inputs)
+{
+	// Small inputs are sorted concurrently, large ones afterwards
+	std::vector<size_t> small, large;
+	for (size_t i = 0 ; i < inputs.size() ; ++i) {
+		struct stat stat_buf;
+		if (stat(inputs[i].c_str(), &stat_buf) == 0 
+				&& (size_t)stat_buf.st_size > BatchSmall)
+			large.push_back(i);
+		else
+			small.push_back(i);
+	}
+
+	err << SELF << ": sorting " << small.size() << " small and "
+			<< large.size() << " large inputs" << std::endl;
+
+	size_t failed = 0;
+	{
+		scheduler sched(jobs, opts.pin);
+		sched.parallel_for( [&](size_t p, size_t n, size_t) {
+			for (size_t i = p ; i < p + n ; ++i) {
+				if (!sort_file(inputs[ small[i] ], 1))
+					__atomic_fetch_add(&failed, 1, __ATOMIC_RELAXED);
+			}
+		}, 0, small.size(), 1 );
+	}
+
+	for (size_t i = 0 ; i < large.size() ; ++i) {
+		if (!sort_file(inputs[ large[i] ], jobs)) ++failed;
+	}
+
+	release_pool();
+
+	err << SELF << ": sorted " << (inputs.size() - failed) << " of " 
+			<< inputs.size() << " inputs" << std::endl;
+
+	return failed;
+}
+
+bool tupla::batchsort::sort_file(const std::string& in_name, 
+		const uint32 sort_jobs)
+{
+	// Messages of concurrent sorters are discarded
+	std::ostream quiet(0);
+	std::ostream& sort_err = (sort_jobs > 1 ? err : quiet);
+
+	char * text_eof = 0;
+	try {
+		std::string out_sa_name(boost::str( boost::format("%1%.%2%") 
+				% in_name % RankFileSuffix ) );
+		std::string out_lcp_name(boost::str( boost::format("%1%.%2%") 
+				% in_name % LCPFileSuffix ) );
+		if (bopts.write && !bopts.force) {
+			if (std::ifstream( out_sa_name.c_str() ).is_open() 
+					|| (bopts.lcp 
+					&& std::ifstream( out_lcp_name.c_str() ).is_open())) {
+				throw std::runtime_error("output exists");
+			}
+		}
+
+		size_t len = (size_t)stat_filesize(in_name);
+		if (len > MaxInput) {
+			throw std::runtime_error("input file too large");
+		}
+		size_t len_eof = len + 1;
+		text_eof = (char *)read_byte_string(in_name, len);
+
+		uint32 index_bits = bopts.index_bits;
+		if (index_bits == IndexBitsAuto) {
+			index_bits = (len <= index_traits<uint32>::MaxInput ? 32
+					: (len <= index_traits<uint40>::MaxInput ? 40 : 64));
+		}
+
+		if (index_bits == 32 && len > index_traits<uint32>::MaxInput) {
+			throw std::runtime_error("input file too large for 32-bit indices");
+		}
+		if (index_bits == 40 && len > index_traits<uint40>::MaxInput) {
+			throw std::runtime_error("input file too large for 40-bit indices");
+		}
+
+		if (index_bits == 32) {
+			sort_text<uint32>(text_eof, len_eof, sort_jobs, out_sa_name,
+					out_lcp_name, sort_err);
+		}
+		else if (index_bits == 40) {
+			sort_text<uint40>(text_eof, len_eof, sort_jobs, out_sa_name,
+					out_lcp_name, sort_err);
+		}
+		else {
+			sort_text<uint64>(text_eof, len_eof, sort_jobs, out_sa_name,
+					out_lcp_name, sort_err);
+		}
+
+		delete [] text_eof;
+	}
+	catch (std::exception& e) {
+		delete [] text_eof;
+		boost::mutex::scoped_lock lock(err_lock);
+		err << SELF << ": " << in_name << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+template <typename T>
+void tupla::batchsort::sort_text(const char * text_eof, const size_t len_eof,
+		const uint32 sort_jobs, const std::string& out_sa_name,
+		const std::string& out_lcp_name, std::ostream& sort_err)
+{
+	std::unique_ptr< suffixsort<T> > sorter( suffixsort<T>::instance(
+			text_eof, len_eof, sort_jobs, sort_err, opts) );
+
+	sorter->build_sa();
+	if (bopts.lcp) sorter->build_lcp();
+
+	if (!bopts.write) return;
+
+	write_index_array(sorter->get_sa(), len_eof, out_sa_name);
+	if (bopts.lcp) write_index_array(sorter->get_lcp(), len_eof, out_lcp_name);
+}
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,70 @@
+/**
+ * Batch suffix sorting of many input files in one process. Small inputs
+ * are sorted concurrently, one sequential sorter per input on the
+ * workers of one scheduler, with arrays reused across inputs through
+ * the buffer pool. Large inputs are sorted after them one at a time
+ * with all jobs.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+#include "numdefs.hpp"
+#include "tupla.hpp"
+
+namespace tupla {
+
+// Options for batch outputs
+struct batchopts
+{
+	batchopts() : lcp(false), write(true), force(false), 
+		index_bits(IndexBitsAuto) { }
+
+	bool lcp; // Compute and write LCP arrays
+	bool write; // Write output files
+	bool force; // Overwrite existing output files
+	uint32 index_bits; // Width of output indices
+};
+
+class batchsort {
+
+private:
+	batchsort(const batchsort&);
+	batchsort& operator=(const batchsort&);
+
+	const uint32 jobs; // Threads for sorting
+	std::ostream& err; // Error stream
+	const sortopts opts; // Tuning options of sorters
+	const batchopts bopts; // Output options
+
+	// Serializes messages of concurrent sorters
+	boost::mutex err_lock;
+
+	// Sort one input with sorter using jobs, false if it failed
+	bool sort_file(const std::string&, const uint32);
+
+	// Sort text and write outputs using index type T
+	template <typename T>
+	void sort_text(const char *, const size_t, const uint32, 
+			const std::string&, const std::string&, std::ostream&);
+
+public:
+	batchsort(const uint32, std::ostream&, const sortopts&, const batchopts&);
+	~batchsort();
+
+	// Input files in directory, or listed one per line in file
+	static std::vector<std::string> list_inputs(const std::string&);
+
+	// Sort all inputs, returns number of inputs which failed
+	size_t run(const std::vector<std::string>&);
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,504 @@
+#include "extsort.hpp"
+#include "suffixsort.hpp"
+#include "memory.hpp"
+#include "tupla.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sys/resource.h>
+#include <boost/format.hpp>
+
+using namespace tupla;
+
+template <typename T>
+tupla::extsort<T>::extsort(const char * text, const size_t len,
+		const uint32 jobs, std::ostream& err, const sortopts& opts,
+		const size_t memory, const size_t overlap)
+	: text(text), len(len), jobs(jobs), err(err), opts(opts),
+	  memory(memory), overlap(overlap)
+{
+	// Singleton group lists of each thread have minimum length, and
+	// short groups are gathered to buffer of each thread
+	size_t fixed = jobs * PatchMinimum * sizeof(T);
+	if (opts.gather) fixed += jobs * BucketSize * 2 * sizeof(uint64);
+
+	// Each suffix has block text, suffix array, inverse, assignment array
+	// and radix scatter of sorter, 1/16 index for singleton group lists,
+	// and index in block list
+	block = 0;
+	if (memory > fixed) {
+		block = ((memory - fixed) * 16) / (16 + (81 * sizeof(T)));
+	}
+	if (block <= overlap) {
+		throw std::runtime_error("memory limit too small for blocks");
+	}
+	block -= overlap;
+}
+
+template <typename T>
+tupla::extsort<T>::~extsort()
+{
+}
+
+template <typename T>
+void tupla::extsort<T>::build_sa(const std::string& prefix,
+		const std::string& out_name)
+{
+	size_t blocks = (len + block - 1) / block;
+	std::vector<std::string> block_names;
+
+	for (size_t b = 0 ; b < blocks ; ++b) {
+		size_t p = b * block;
+		size_t n = std::min(block, len - p);
+
+		err << SELF << ": sorting block " << (b + 1) << " of " << blocks
+				<< std::endl;
+
+		block_names.push_back( boost::str( boost::format("%1%.%2%")
+				% prefix % b ) );
+		sort_block(p, n, block_names.back());
+	}
+
+	err << SELF << ": merging " << blocks << " blocks" << std::endl;
+
+	// Output mapped to file so that groups are sorted in place
+	const std::string sa_name = (out_name.empty() ? (prefix + ".sa") : out_name);
+	const std::string group_name = prefix + ".groups";
+	T * out = alloc_array<T>(len, sa_name);
+
+	// Block files are merged in passes until few enough to merge at once
+	std::vector<std::string> names = block_names;
+	for (size_t pass = 0 ; names.size() > fan_in(sizeof(T)) ; ++pass) {
+		err << SELF << ": merging " << names.size() << " files in pass "
+				<< (pass + 1) << std::endl;
+		names = merge_pass(names, boost::str( boost::format("%1%.merge.%2%")
+				% prefix % pass ));
+	}
+
+	size_t members = merge(names, out, group_name);
+	for (auto name : names)
+		std::remove(name.c_str());
+
+	if (members > 0) {
+		rank_groups(out, group_name, prefix);
+		sort_groups(out, prefix, members);
+	}
+	std::remove(group_name.c_str());
+
+	free_array(out);
+	if (out_name.empty()) std::remove(sa_name.c_str());
+}
+
+template <typename T>
+void tupla::extsort<T>::sort_block(size_t p, size_t n,
+		const std::string& block_name)
+{
+	// Text in block and overlap, terminated at end of input
+	size_t e = std::min(len - 1, p + n + overlap);
+	size_t m = e - p;
+	char * block_text = new char[m + 1 + TextPadding];
+	memcpy(block_text, (text + p), m);
+	memset((block_text + m), 0, 1 + TextPadding);
+
+	std::vector<T> block_sa;
+	block_sa.reserve(n);
+	{
+		std::unique_ptr< suffixsort<T> > sorter( suffixsort<T>::instance(
+				block_text, (m + 1), jobs, err, opts) );
+		sorter->build_sa();
+
+		// Suffixes starting in block, terminator of last block is terminator
+		// of input. Suffixes with common prefix of overlap are ordered in
+		// groups after merge
+		const T * const sa = sorter->get_sa();
+		for (size_t i = 0 ; i < (m + 1) ; ++i) {
+			size_t j = sa[i];
+			if (j < n) block_sa.push_back(p + j);
+		}
+	}
+	delete [] block_text;
+
+	std::ofstream out(block_name.c_str(), std::ios::binary);
+	out.write((const char *)&block_sa[0], (n * sizeof(T)));
+	if (!out) {
+		throw std::runtime_error("could not write block file");
+	}
+}
+
+template <typename T>
+size_t tupla::extsort<T>::fan_in(const size_t bytes) const
+{
+	// Half of memory for read buffers, other half for sorting and writing
+	size_t fan = memory / (2 * ExternalBuffer * bytes);
+
+	// Descriptors for standard streams and output are kept free
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+			&& limit.rlim_cur != RLIM_INFINITY) {
+		const size_t files = limit.rlim_cur;
+		fan = std::min(fan, (files > ExternalFiles ? files - ExternalFiles : 0));
+	}
+
+	return std::max((size_t)2, fan);
+}
+
+template <typename T>
+template <class F>
+void tupla::extsort<T>::merge_files(const std::vector<std::string>& names,
+		F emit)
+{
+	// Next suffix of file
+	struct head {
+		uint64 key;
+		size_t pos;
+		size_t b;
+	};
+	auto after = [&](const head& x, const head& y) {
+		if (x.key != y.key) return (x.key > y.key);
+		return before(y.pos, x.pos);
+	};
+	std::priority_queue<head, std::vector<head>, decltype(after)> heads(after);
+
+	const size_t files = names.size();
+	std::vector< std::unique_ptr< reader<T> > > in(files);
+	auto pop = [&](size_t b) {
+		T pos;
+		if (in[b]->read(pos)) heads.push( head{ prefix_key(pos), pos, b } );
+	};
+
+	for (size_t b = 0 ; b < files ; ++b) {
+		in[b].reset( new reader<T>(names[b], ExternalBuffer) );
+		pop(b);
+	}
+
+	while (!heads.empty()) {
+		head h = heads.top();
+		heads.pop();
+		pop(h.b);
+		emit(h.pos);
+	}
+}
+
+template <typename T>
+std::vector<std::string> tupla::extsort<T>::merge_pass(
+		const std::vector<std::string>& names, const std::string& prefix)
+{
+	// Files are merged in order of suffixes on first overlap characters,
+	// so suffixes with common prefix of overlap stay consecutive
+	const size_t fan = fan_in(sizeof(T));
+	std::vector<std::string> merged;
+	for (size_t i = 0 ; i < names.size() ; i += fan) {
+		std::vector<std::string> part(names.begin() + i,
+				names.begin() + std::min(names.size(), i + fan));
+
+		merged.push_back( boost::str( boost::format("%1%.%2%")
+				% prefix % merged.size() ) );
+		writer<T> out(merged.back(), ExternalBuffer);
+		merge_files(part, [&](size_t pos) { out.write(pos); });
+		out.close();
+
+		for (auto name : part)
+			std::remove(name.c_str());
+	}
+
+	return merged;
+}
+
+template <typename T>
+size_t tupla::extsort<T>::merge(const std::vector<std::string>& names,
+		T * out, const std::string& group_name)
+{
+	// Suffixes with common prefix of overlap are listed with name of their
+	// group, which is the rank of its first suffix
+	writer<rank_tuple> groups(group_name, ExternalBuffer);
+	size_t members = 0;
+	size_t first = 0;
+	size_t r = 0;
+	merge_files(names, [&](size_t pos) {
+		if (r > 0 && same_prefix(out[r-1], pos)) {
+			if (first == r - 1) {
+				groups.write( rank_tuple{ first, 0, out[r-1] } );
+				++members;
+			}
+			groups.write( rank_tuple{ first, 0, pos } );
+			++members;
+		}
+		else {
+			first = r;
+		}
+		out[r++] = pos;
+	} );
+	groups.close();
+
+	return members;
+}
+
+template <typename T>
+void tupla::extsort<T>::rank_groups(const T * out,
+		const std::string& group_name, const std::string& prefix)
+{
+	const std::string named_name = prefix + ".named";
+	const std::string sorted_name = prefix + ".sorted";
+	const std::string rank_name = prefix + ".ranks";
+
+	// Name of each suffix is its rank, or name of its group listed in
+	// group file in order of rank
+	{
+		reader<rank_tuple> in(group_name, ExternalBuffer);
+		writer<rank_tuple> named(named_name, ExternalBuffer);
+		rank_tuple x;
+		bool more = in.read(x);
+		for (size_t r = 0 ; r < len ; ++r) {
+			size_t name = r;
+			if (more && x.pos == out[r]) {
+				name = x.name;
+				more = in.read(x);
+			}
+			named.write( rank_tuple{ name, 0, out[r] } );
+		}
+		named.close();
+	}
+	sort_tuples(named_name, sorted_name, len, by_pos());
+	std::remove(named_name.c_str());
+
+	// Names in order of position
+	{
+		reader<rank_tuple> in(sorted_name, ExternalBuffer);
+		writer<T> ranks(rank_name, ExternalBuffer);
+		rank_tuple x;
+		while (in.read(x))
+			ranks.write(x.name);
+		ranks.close();
+	}
+	std::remove(sorted_name.c_str());
+}
+
+template <typename T>
+void tupla::extsort<T>::sort_groups(T * out, const std::string& prefix,
+		size_t members)
+{
+	const std::string group_name = prefix + ".groups";
+	const std::string keyed_name = prefix + ".keyed";
+	const std::string sorted_name = prefix + ".sorted";
+	const std::string named_name = prefix + ".named";
+	const std::string done_name = prefix + ".done";
+	const std::string rank_name = prefix + ".ranks";
+	const std::string update_name = prefix + ".ranks.new";
+
+	// Sorted suffixes with their rank, written to output in order of rank
+	writer<rank_tuple> done(done_name, ExternalBuffer);
+	size_t finished = 0;
+
+	// Suffixes in group have common prefix of h characters
+	for (size_t h = overlap ; members > 0 ; h <<= 1) {
+		err << SELF << ": sorting " << members << " suffixes in groups"
+				<< " with common prefix of " << h << std::endl;
+
+		// Position of suffix following common prefix, which is inside text
+		// since shorter suffixes contain the unique terminator
+		{
+			reader<rank_tuple> in(group_name, ExternalBuffer);
+			writer<rank_tuple> keyed(keyed_name, ExternalBuffer);
+			rank_tuple x;
+			while (in.read(x)) {
+				x.next = x.pos + h;
+				keyed.write(x);
+			}
+			keyed.close();
+		}
+		sort_tuples(keyed_name, sorted_name, members, by_next());
+
+		// Rank of following suffix joined from ranks in order of position,
+		// read before names change
+		{
+			reader<rank_tuple> in(sorted_name, ExternalBuffer);
+			reader<T> ranks(rank_name, ExternalBuffer);
+			writer<rank_tuple> keyed(keyed_name, ExternalBuffer);
+			rank_tuple x;
+			size_t at = 0;
+			T rank = 0;
+			while (in.read(x)) {
+				while (at <= x.next && ranks.read(rank)) ++at;
+				x.next = rank;
+				keyed.write(x);
+			}
+			keyed.close();
+		}
+		sort_tuples(keyed_name, sorted_name, members, std::less<rank_tuple>());
+		std::remove(keyed_name.c_str());
+
+		// Name of each suffix is the rank of first suffix in group with the
+		// same following rank. Singleton groups are sorted
+		size_t renamed = 0;
+		{
+			reader<rank_tuple> in(sorted_name, ExternalBuffer);
+			writer<rank_tuple> groups(group_name, ExternalBuffer);
+			writer<rank_tuple> named(named_name, ExternalBuffer);
+			rank_tuple prev = { 0, 0, 0 }, x, y;
+			bool more = in.read(y);
+			size_t first = 0; // Index of first suffix with same group
+			size_t start = 0; // Index of first suffix with same following rank
+			members = 0;
+			for (size_t i = 0 ; more ; ++i) {
+				x = y;
+				more = in.read(y);
+				if (i == 0 || x.name != prev.name) first = i;
+				if (i == 0 || x.name != prev.name || x.next != prev.next) start = i;
+				const size_t name = x.name + (start - first);
+				if (name != x.name) {
+					named.write( rank_tuple{ name, 0, x.pos } );
+					++renamed;
+				}
+				if (start == i && !(more && y.name == x.name && y.next == x.next)) {
+					done.write( rank_tuple{ name, 0, x.pos } );
+					++finished;
+				}
+				else {
+					groups.write( rank_tuple{ name, 0, x.pos } );
+					++members;
+				}
+				prev = x;
+			}
+			groups.close();
+			named.close();
+		}
+
+		// New names merged into ranks in order of position
+		if (members > 0 && renamed > 0) {
+			sort_tuples(named_name, sorted_name, renamed, by_pos());
+			{
+				reader<T> ranks(rank_name, ExternalBuffer);
+				reader<rank_tuple> in(sorted_name, ExternalBuffer);
+				writer<T> updated(update_name, ExternalBuffer);
+				rank_tuple x;
+				bool more = in.read(x);
+				T rank;
+				for (size_t i = 0 ; ranks.read(rank) ; ++i) {
+					if (more && x.pos == i) {
+						rank = x.name;
+						more = in.read(x);
+					}
+					updated.write(rank);
+				}
+				updated.close();
+			}
+			if (std::rename(update_name.c_str(), rank_name.c_str()) != 0) {
+				throw std::runtime_error("could not write temporary file");
+			}
+		}
+		std::remove(named_name.c_str());
+		std::remove(sorted_name.c_str());
+	}
+	done.close();
+
+	// Sorted suffixes written to output in order of rank
+	sort_tuples(done_name, sorted_name, finished, std::less<rank_tuple>());
+	{
+		reader<rank_tuple> in(sorted_name, ExternalBuffer);
+		rank_tuple x;
+		while (in.read(x))
+			out[x.name] = x.pos;
+	}
+	std::remove(done_name.c_str());
+	std::remove(sorted_name.c_str());
+	std::remove(rank_name.c_str());
+}
+
+template <typename T>
+template <class C>
+void tupla::extsort<T>::sort_tuples(const std::string& in_name,
+		const std::string& out_name, size_t count, C less)
+{
+	const size_t run = std::max((size_t)ExternalBuffer,
+			(memory / sizeof(rank_tuple)));
+	const size_t runs = (count + run - 1) / run;
+	std::vector<std::string> run_names;
+
+	// Runs fitting memory are sorted to files, single run to output
+	{
+		reader<rank_tuple> in(in_name, ExternalBuffer);
+		std::vector<rank_tuple> tuples;
+		tuples.reserve(std::min(run, count));
+		for (size_t i = 0 ; i < runs ; ++i) {
+			run_names.push_back( (runs == 1) ? out_name :
+					boost::str( boost::format("%1%.%2%") % in_name % i ) );
+			tuples.clear();
+			rank_tuple x;
+			while (tuples.size() < run && in.read(x))
+				tuples.push_back(x);
+			std::sort(tuples.begin(), tuples.end(), less);
+
+			writer<rank_tuple> out(run_names.back(), ExternalBuffer);
+			for (auto& t : tuples)
+				out.write(t);
+			out.close();
+		}
+	}
+	if (runs <= 1) return;
+
+	// Runs are merged in passes until few enough to merge at once, the
+	// last pass to output
+	const size_t fan = fan_in(sizeof(rank_tuple));
+	for (size_t pass = 0 ; run_names.size() > 1 ; ++pass) {
+		std::vector<std::string> merged;
+		for (size_t i = 0 ; i < run_names.size() ; i += fan) {
+			std::vector<std::string> part(run_names.begin() + i,
+					run_names.begin() + std::min(run_names.size(), i + fan));
+			merged.push_back( (run_names.size() <= fan) ? out_name :
+					boost::str( boost::format("%1%.merge.%2%.%3%")
+					% in_name % pass % merged.size() ) );
+			merge_tuples(part, merged.back(), (run / part.size()), less);
+
+			for (auto name : part)
+				std::remove(name.c_str());
+		}
+		run_names.swap(merged);
+	}
+}
+
+template <typename T>
+template <class C>
+void tupla::extsort<T>::merge_tuples(const std::vector<std::string>& names,
+		const std::string& out_name, size_t size, C less)
+{
+	// Merge runs reading through buffers sharing memory
+	struct head {
+		rank_tuple t;
+		size_t i;
+	};
+	auto after = [&](const head& x, const head& y) { return less(y.t, x.t); };
+	std::priority_queue<head, std::vector<head>, decltype(after)> heads(after);
+
+	const size_t runs = names.size();
+	std::vector< std::unique_ptr< reader<rank_tuple> > > in(runs);
+	auto pop = [&](size_t i) {
+		rank_tuple x;
+		if (in[i]->read(x)) heads.push( head{ x, i } );
+	};
+	for (size_t i = 0 ; i < runs ; ++i) {
+		in[i].reset( new reader<rank_tuple>(names[i],
+				std::max((size_t)(1 << 10), size)) );
+		pop(i);
+	}
+
+	writer<rank_tuple> out(out_name, ExternalBuffer);
+	while (!heads.empty()) {
+		head h = heads.top();
+		heads.pop();
+		out.write(h.t);
+		pop(h.i);
+	}
+	out.close();
+}
+
+template class tupla::extsort<uint32>;
+template class tupla::extsort<uint64>;
+template class tupla::extsort<uint40>;
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,230 @@
+/**
+ * External memory suffix sort for inputs larger than memory. Suffixes
+ * starting in each block of the input are sorted with the in-memory
+ * sorters on the block extended with following overlap bytes, and
+ * written to a temporary file. Block files are merged to the output in
+ * passes of as many files as fit in memory and open files limit. Merge
+ * compares at most overlap bytes, so suffixes with longer common prefix
+ * form groups. Groups are sorted by prefix doubling over ranks: each
+ * round sorts the suffixes in groups on disk by the rank of the suffix
+ * following the sorted prefix. Ranks are kept in a temporary file in
+ * order of position, and joined to the suffixes sorted by position of
+ * the following suffix, so the file is only read sequentially.
+ *
+ * Template parameter T is the index type of suffix array.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#include "numdefs.hpp"
+#include "index.hpp"
+#include "tupla.hpp"
+
+namespace tupla {
+
+template <typename T = uint32>
+class extsort {
+
+private:
+	extsort(const extsort&);
+	extsort& operator=(const extsort&);
+
+	const char * const text; // Input
+	const size_t len; // Length of input
+	const uint32 jobs; // Threads for sorting blocks
+	std::ostream& err; // Error stream
+	const sortopts opts; // Tuning options
+	const size_t memory; // Bytes of memory for blocks and runs
+	const size_t overlap; // Bytes following block in sorted text
+	size_t block; // Suffixes in each block
+
+	// Suffix in group with name of group and rank of following suffix
+	struct rank_tuple {
+		uint64 name;
+		uint64 next;
+		uint64 pos;
+
+		bool operator<(const rank_tuple& x) const
+		{
+			if (name != x.name) return (name < x.name);
+			if (next != x.next) return (next < x.next);
+			return (pos < x.pos);
+		}
+	};
+
+	// Tuples ordered by position of following suffix
+	struct by_next {
+		bool operator()(const rank_tuple& x, const rank_tuple& y) const
+		{
+			return (x.next < y.next);
+		}
+	};
+
+	// Tuples ordered by position of suffix
+	struct by_pos {
+		bool operator()(const rank_tuple& x, const rank_tuple& y) const
+		{
+			return (x.pos < y.pos);
+		}
+	};
+
+	// Buffered sequential reads of records from temporary file
+	template <typename R>
+	class reader {
+	public:
+		reader(const std::string& name, const size_t size)
+			: in(name.c_str(), std::ios::binary), buf(size), next(0), end(0)
+		{
+			if (!in.is_open()) {
+				throw std::runtime_error("could not read temporary file");
+			}
+		}
+
+		// Read next record, false at end of file
+		bool read(R& r)
+		{
+			if (next == end) {
+				in.read((char *)&buf[0], (buf.size() * sizeof(R)));
+				end = in.gcount() / sizeof(R);
+				next = 0;
+				if (end == 0) return false;
+			}
+			r = buf[next++];
+			return true;
+		}
+
+	private:
+		std::ifstream in;
+		std::vector<R> buf;
+		size_t next;
+		size_t end;
+	};
+
+	// Buffered sequential writes of records to temporary file
+	template <typename R>
+	class writer {
+	public:
+		writer(const std::string& name, const size_t size)
+			: out(name.c_str(), std::ios::binary), size(size)
+		{
+			if (!out.is_open()) {
+				throw std::runtime_error("could not write temporary file");
+			}
+			buf.reserve(size);
+		}
+
+		void write(const R& r)
+		{
+			buf.push_back(r);
+			if (buf.size() == size) flush();
+		}
+
+		// Write buffered records and check file was written
+		void close()
+		{
+			flush();
+			out.close();
+			if (!out) {
+				throw std::runtime_error("could not write temporary file");
+			}
+		}
+
+	private:
+		void flush()
+		{
+			if (!buf.empty()) {
+				out.write((const char *)&buf[0], (buf.size() * sizeof(R)));
+			}
+			buf.clear();
+		}
+
+		std::ofstream out;
+		std::vector<R> buf;
+		const size_t size;
+	};
+
+	// Sort suffixes starting in range p..p+n-1 to file
+	void sort_block(size_t p, size_t n, const std::string&);
+
+	// Merge sorted block files to output, suffixes with common prefix of
+	// overlap are written to group file. Returns suffixes in groups
+	size_t merge(const std::vector<std::string>&, T *, const std::string&);
+
+	// Files merged at once with buffers of records of bytes, bounded by
+	// memory and by open files allowed for process
+	size_t fan_in(const size_t) const;
+
+	// Merge sorted files of suffixes calling emit(pos) in order
+	template <class F>
+	void merge_files(const std::vector<std::string>&, F);
+
+	// Merge each fan_in() files to file named with prefix, returns names
+	// of merged files. Merged files are removed
+	std::vector<std::string> merge_pass(const std::vector<std::string>&,
+			const std::string&);
+
+	// Write names of suffixes in order of position to ranks file named
+	// with prefix, from output and names of groups in group file
+	void rank_groups(const T *, const std::string&, const std::string&);
+
+	// Sort suffixes of groups in file by prefix doubling
+	void sort_groups(T *, const std::string&, size_t);
+
+	// Sort tuples of input file to output file in runs fitting memory
+	template <class C>
+	void sort_tuples(const std::string&, const std::string&, size_t, C);
+
+	// Merge sorted runs to output file reading through buffers of size
+	template <class C>
+	void merge_tuples(const std::vector<std::string>&, const std::string&,
+			size_t, C);
+
+	// Suffix a is before suffix b in first overlap characters, ties
+	// ordered by position
+	inline bool before(const size_t a, const size_t b) const
+	{
+		size_t m = std::min(overlap, len - std::max(a, b));
+		int c = memcmp((text + a), (text + b), m);
+		return (c != 0 ? (c < 0) : (a < b));
+	}
+
+	// Suffixes a and b have common prefix of overlap characters, shorter
+	// suffixes contain the unique terminator
+	inline bool same_prefix(const size_t a, const size_t b) const
+	{
+		if (len - std::max(a, b) <= overlap) return false;
+		return (memcmp((text + a), (text + b), overlap) == 0);
+	}
+
+	// First 8 characters of suffix as key comparable as integer
+	inline uint64 prefix_key(const size_t a) const
+	{
+		uint64 key = 0;
+		for (size_t i = 0 ; i < 8 ; ++i)
+			key = (key << 8) | (uint8)text[a + i];
+		return key;
+	}
+
+public:
+	// Sort text in blocks fitting memory bytes
+	extsort(const char *, const size_t, const uint32, std::ostream&,
+			const sortopts&, const size_t, const size_t = ExternalOverlap);
+	~extsort();
+
+	// Build suffix array to output file using temporary files named with
+	// prefix, output is discarded if name is empty
+	void build_sa(const std::string&, const std::string&);
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,95 @@
+/**
+ * Properties of index types in suffix and LCP arrays.
+ *
+ * Packed 40-bit index type takes 5 bytes per entry, for inputs over 2 GiB
+ * with less memory than 64-bit indices.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include "numdefs.hpp"
+
+namespace tupla {
+
+// Unsigned 40-bit integer stored in 5 bytes, low bits first
+struct __attribute__((packed)) uint40
+{
+	uint32 lo;
+	uint8 hi;
+
+	uint40() = default;
+
+	uint40(const uint64 v) : lo((uint32)v), hi((uint8)(v >> 32)) { }
+
+	inline operator uint64() const
+	__attribute__((always_inline))
+	{
+		return ((uint64)hi << 32) | lo;
+	}
+
+	inline uint40& operator=(const uint64 v)
+	__attribute__((always_inline))
+	{
+		lo = (uint32)v; hi = (uint8)(v >> 32);
+		return *this;
+	}
+
+	inline uint40& operator+=(const uint64 v) { return (*this = *this + v); }
+	inline uint40& operator-=(const uint64 v) { return (*this = *this - v); }
+	inline uint40& operator++() { return (*this += 1); }
+	inline uint40& operator--() { return (*this -= 1); }
+	inline uint40 operator++(int) { uint40 t(*this); ++(*this); return t; }
+	inline uint40 operator--(int) { uint40 t(*this); --(*this); return t; }
+};
+
+template <typename T>
+struct index_traits
+{
+	// Bits in index
+	static const uint32 Bits = sizeof(T) * 8;
+
+	// Highest bit in suffix array marks sorted group
+	static const uint64 SortedFlag = ((uint64)1 << (Bits - 1));
+
+	// Largest index value
+	static const uint64 Max = (~(uint64)0 >> (64 - Bits));
+
+	// Maximum input length
+	static const uint64 MaxInput = (SortedFlag - 2);
+};
+
+// Read index that another thread may be writing
+template <typename T>
+inline uint64 index_load(const T * p)
+{
+	return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+// Write index that another thread may be reading
+template <typename T>
+inline void index_store(T * p, const uint64 v)
+{
+	__atomic_store_n(p, (T)v, __ATOMIC_RELAXED);
+}
+
+// Packed indices have no atomic access. A reader may see the high byte
+// of the old value with the low bits of the new one, so readers must
+// range check values before using them and detect stale ones later
+inline uint64 index_load(const uint40 * p)
+{
+	const volatile uint40 * vp = p;
+	return ((uint64)vp->hi << 32) | vp->lo;
+}
+
+inline void index_store(uint40 * p, const uint64 v)
+{
+	volatile uint40 * vp = p;
+	vp->lo = (uint32)v;
+	vp->hi = (uint8)(v >> 32);
+}
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
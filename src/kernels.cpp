@@ -0,0 +1,276 @@
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "kernels.hpp"
+
+using namespace tupla;
+
+// Flags for _mm_cmpistri intrisic in SSE4.2 lcplen:
+// Unsigned bytes source
+// Equal each compare: match a[i] with b[i]
+// Negative polarity gives matching elements
+//
+// Intel SSE4 Programming Reference
+// @see http://software.intel.com/sites/default/files/m/0/3/c/d/4/18187-d9156103.pdf 
+#define LCPLEN_FLAGS (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY )
+
+// Compare 8 characters at a time, first differing byte is lowest set bit
+// of difference on little endian words
+static size_t lcplen_generic(const char * a, const char * b)
+{
+	size_t l = 0;
+	for (;;) {
+		uint64 wa, wb;
+		memcpy(&wa, a + l, sizeof(wa));
+		memcpy(&wb, b + l, sizeof(wb));
+		if (wa != wb) return l + (__builtin_ctzll(wa ^ wb) >> 3);
+		l += sizeof(wa);
+	}
+}
+
+// Compare 16 characters at a time, also stops at null
+__attribute__((target("sse4.2")))
+static size_t lcplen_sse42(const char * a, const char * b)
+{
+	size_t l = 0;
+	for (;;) {
+		const __m128i xa = _mm_loadu_si128((const __m128i *)(a + l));
+		const __m128i xb = _mm_loadu_si128((const __m128i *)(b + l));
+		const size_t n = _mm_cmpistri(xa, xb, LCPLEN_FLAGS);
+		if (n < 16) return l + n;
+		l += 16;
+	}
+}
+
+// Compare 32 characters at a time, mask has bit set for equal bytes
+__attribute__((target("avx2")))
+static size_t lcplen_avx2(const char * a, const char * b)
+{
+	size_t l = 0;
+	for (;;) {
+		const __m256i xa = _mm256_loadu_si256((const __m256i *)(a + l));
+		const __m256i xb = _mm256_loadu_si256((const __m256i *)(b + l));
+		const uint32 eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(xa, xb));
+		if (eq != 0xFFFFFFFF) return l + __builtin_ctz(~eq);
+		l += 32;
+	}
+}
+
+// Compare 64 characters at a time, mask has bit set for differing bytes
+__attribute__((target("avx512f,avx512bw")))
+static size_t lcplen_avx512(const char * a, const char * b)
+{
+	size_t l = 0;
+	for (;;) {
+		const __m512i xa = _mm512_loadu_si512((const void *)(a + l));
+		const __m512i xb = _mm512_loadu_si512((const void *)(b + l));
+		const uint64 ne = _mm512_cmpneq_epi8_mask(xa, xb);
+		if (ne != 0) return l + __builtin_ctzll(ne);
+		l += 64;
+	}
+}
+
+static void gather_generic(const uint32 * isa_h, const uint32 * sa,
+		size_t n, uint32 * out)
+{
+	for (size_t i = 0 ; i < n ; ++i) {
+		out[2*i] = isa_h[ sa[i] ];
+		out[2*i + 1] = sa[i];
+	}
+}
+
+// Gather 8 keys at a time, interleave with suffixes within 128-bit lanes
+// and put lanes back in order
+__attribute__((target("avx2")))
+static void gather_avx2(const uint32 * isa_h, const uint32 * sa,
+		size_t n, uint32 * out)
+{
+	size_t i = 0;
+	for ( ; i + 8 <= n ; i += 8) {
+		const __m256i v = _mm256_loadu_si256((const __m256i *)(sa + i));
+		const __m256i k = _mm256_i32gather_epi32((const int *)isa_h, v, 4);
+		const __m256i lo = _mm256_unpacklo_epi32(k, v);
+		const __m256i hi = _mm256_unpackhi_epi32(k, v);
+		_mm256_storeu_si256((__m256i *)(out + 2*i),
+				_mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(out + 2*i + 8),
+				_mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	gather_generic(isa_h, sa + i, n - i, out + 2*i);
+}
+
+// Gather 16 keys at a time, interleave with suffixes by permutation
+// Masked intrinsics with defined sources avoid uninitialized warnings
+__attribute__((target("avx512f")))
+static void gather_avx512(const uint32 * isa_h, const uint32 * sa,
+		size_t n, uint32 * out)
+{
+	const __m512i first = _mm512_set_epi32(23, 7, 22, 6, 21, 5, 20, 4,
+			19, 3, 18, 2, 17, 1, 16, 0);
+	const __m512i second = _mm512_set_epi32(31, 15, 30, 14, 29, 13, 28, 12,
+			27, 11, 26, 10, 25, 9, 24, 8);
+	const __m512i zero = _mm512_setzero_si512();
+	size_t i = 0;
+	for ( ; i + 16 <= n ; i += 16) {
+		const __m512i v = _mm512_loadu_si512((const void *)(sa + i));
+		const __m512i k = _mm512_mask_i32gather_epi32(zero, 0xFFFF, v,
+				(const void *)isa_h, 4);
+		_mm512_storeu_si512((void *)(out + 2*i),
+				_mm512_permutex2var_epi32(k, first, v));
+		_mm512_storeu_si512((void *)(out + 2*i + 16),
+				_mm512_permutex2var_epi32(k, second, v));
+	}
+	gather_generic(isa_h, sa + i, n - i, out + 2*i);
+}
+
+static void bounds_generic(const uint32 * isa_h, const uint32 * sa,
+		size_t n, size_t * lo, size_t * hi)
+{
+	for (size_t i = 0 ; i < n ; ++i) {
+		const size_t k = isa_h[ sa[i] ];
+		if (k < *lo) *lo = k;
+		if (k > *hi) *hi = k;
+	}
+}
+
+__attribute__((target("avx2")))
+static void bounds_avx2(const uint32 * isa_h, const uint32 * sa,
+		size_t n, size_t * lo, size_t * hi)
+{
+	if (n < 8) return bounds_generic(isa_h, sa, n, lo, hi);
+
+	__m256i vlo = _mm256_set1_epi32(-1);
+	__m256i vhi = _mm256_setzero_si256();
+	size_t i = 0;
+	for ( ; i + 8 <= n ; i += 8) {
+		const __m256i v = _mm256_loadu_si256((const __m256i *)(sa + i));
+		const __m256i k = _mm256_i32gather_epi32((const int *)isa_h, v, 4);
+		vlo = _mm256_min_epu32(vlo, k);
+		vhi = _mm256_max_epu32(vhi, k);
+	}
+
+	uint32 l[8], h[8];
+	_mm256_storeu_si256((__m256i *)l, vlo);
+	_mm256_storeu_si256((__m256i *)h, vhi);
+	for (size_t j = 0 ; j < 8 ; ++j) {
+		if (l[j] < *lo) *lo = l[j];
+		if (h[j] > *hi) *hi = h[j];
+	}
+	bounds_generic(isa_h, sa + i, n - i, lo, hi);
+}
+
+// Masked intrinsics with defined sources avoid uninitialized warnings
+__attribute__((target("avx512f")))
+static void bounds_avx512(const uint32 * isa_h, const uint32 * sa,
+		size_t n, size_t * lo, size_t * hi)
+{
+	if (n < 16) return bounds_generic(isa_h, sa, n, lo, hi);
+
+	const __m512i zero = _mm512_setzero_si512();
+	__m512i vlo = _mm512_set1_epi32(-1);
+	__m512i vhi = zero;
+	size_t i = 0;
+	for ( ; i + 16 <= n ; i += 16) {
+		const __m512i v = _mm512_loadu_si512((const void *)(sa + i));
+		const __m512i k = _mm512_mask_i32gather_epi32(zero, 0xFFFF, v,
+				(const void *)isa_h, 4);
+		vlo = _mm512_mask_min_epu32(vlo, 0xFFFF, vlo, k);
+		vhi = _mm512_mask_max_epu32(vhi, 0xFFFF, vhi, k);
+	}
+
+	// Reduce halves, then lanes as in bounds_avx2
+	const __m256i none = _mm256_setzero_si256();
+	const __m256i l8 = _mm256_min_epu32(
+			_mm512_mask_extracti64x4_epi64(none, 0xFF, vlo, 0),
+			_mm512_mask_extracti64x4_epi64(none, 0xFF, vlo, 1));
+	const __m256i h8 = _mm256_max_epu32(
+			_mm512_mask_extracti64x4_epi64(none, 0xFF, vhi, 0),
+			_mm512_mask_extracti64x4_epi64(none, 0xFF, vhi, 1));
+
+	uint32 l[8], h[8];
+	_mm256_storeu_si256((__m256i *)l, l8);
+	_mm256_storeu_si256((__m256i *)h, h8);
+	for (size_t j = 0 ; j < 8 ; ++j) {
+		if (l[j] < *lo) *lo = l[j];
+		if (h[j] > *hi) *hi = h[j];
+	}
+	bounds_generic(isa_h, sa + i, n - i, lo, hi);
+}
+
+void tupla::count_bytes(const uint8 * s, size_t n, size_t * count)
+{
+	// Interleaved tables keep runs of equal bytes from serializing on
+	// increments of the same counter
+	uint32 c[4][256] = { { 0 } };
+	size_t i = 0;
+	while (i < n) {
+		// Flush before 32-bit counters overflow
+		const size_t e = std::min(n, i + ((size_t)1 << 30));
+		for ( ; i + 4 <= e ; i += 4) {
+			++c[0][ s[i] ];
+			++c[1][ s[i+1] ];
+			++c[2][ s[i+2] ];
+			++c[3][ s[i+3] ];
+		}
+		for ( ; i < e ; ++i) ++c[0][ s[i] ];
+
+		for (size_t b = 0 ; b < 256 ; ++b) {
+			count[b] += (size_t)c[0][b] + c[1][b] + c[2][b] + c[3][b];
+			c[0][b] = c[1][b] = c[2][b] = c[3][b] = 0;
+		}
+	}
+}
+
+simd_level tupla::simd_supported()
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw")) return SimdAVX512;
+	if (__builtin_cpu_supports("avx2")) return SimdAVX2;
+	if (__builtin_cpu_supports("sse4.2")) return SimdSSE42;
+	return SimdGeneric;
+}
+
+const char * tupla::simd_name(const simd_level level)
+{
+	switch (level) {
+		case SimdSSE42: return "sse4.2";
+		case SimdAVX2: return "avx2";
+		case SimdAVX512: return "avx512";
+		default: return "generic";
+	}
+}
+
+lcplen_fun tupla::lcplen_version(const simd_level level)
+{
+	switch (level) {
+		case SimdSSE42: return lcplen_sse42;
+		case SimdAVX2: return lcplen_avx2;
+		case SimdAVX512: return lcplen_avx512;
+		default: return lcplen_generic;
+	}
+}
+
+gather_fun tupla::gather_version(const simd_level level)
+{
+	switch (level) {
+		case SimdAVX2: return gather_avx2;
+		case SimdAVX512: return gather_avx512;
+		default: return gather_generic;
+	}
+}
+
+bounds_fun tupla::bounds_version(const simd_level level)
+{
+	switch (level) {
+		case SimdAVX2: return bounds_avx2;
+		case SimdAVX512: return bounds_avx512;
+		default: return bounds_generic;
+	}
+}
+
+const lcplen_fun tupla::lcplen_kernel = lcplen_version( simd_supported() );
+const gather_fun tupla::gather_kernel = gather_version( simd_supported() );
+const bounds_fun tupla::bounds_kernel = bounds_version( simd_supported() );
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
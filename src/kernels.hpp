@@ -0,0 +1,69 @@
+/**
+ * Kernels with versions for several instruction sets. The version for
+ * the processor running the program is selected at startup, so one
+ * build runs on older processors and uses wider vectors on newer ones.
+ * Versions are compiled with target attributes, so the build itself
+ * needs no -march flags.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "numdefs.hpp"
+
+namespace tupla {
+
+// Instruction set levels of kernel versions
+enum simd_level {
+	SimdGeneric = 0,
+	SimdSSE42,
+	SimdAVX2,
+	SimdAVX512
+};
+
+// Highest level supported by processor
+simd_level simd_supported();
+
+// Name of level for messages
+const char * simd_name(const simd_level);
+
+// Length of common prefix of strings a and b. Strings must differ before
+// end of input text, which is padded to allow reading whole vectors
+typedef size_t (*lcplen_fun)(const char *, const char *);
+
+// Version of lcplen for level
+lcplen_fun lcplen_version(const simd_level);
+
+// Version of lcplen for processor
+extern const lcplen_fun lcplen_kernel;
+
+// Gather doubling keys of n suffixes to pairs of key isa_h[ sa[i] ] and
+// suffix sa[i], where isa_h points to inverse suffix array at offset h
+typedef void (*gather_fun)(const uint32 *, const uint32 *, size_t, uint32 *);
+
+// Version of gather for level
+gather_fun gather_version(const simd_level);
+
+// Version of gather for processor
+extern const gather_fun gather_kernel;
+
+// Lower smallest key lo and raise largest key hi to cover doubling keys
+// isa_h[ sa[i] ] of n suffixes
+typedef void (*bounds_fun)(const uint32 *, const uint32 *, size_t,
+		size_t *, size_t *);
+
+// Version of bounds for level
+bounds_fun bounds_version(const simd_level);
+
+// Version of bounds for processor
+extern const bounds_fun bounds_kernel;
+
+// Add count of each byte value in s[0..n-1] to count
+void count_bytes(const uint8 * s, size_t n, size_t * count);
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,136 @@
+#include "libtupla.hpp"
+#include "libtupla.h"
+#include "suffixsort.hpp"
+#include "tupla.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+using namespace tupla;
+
+template <typename T>
+tupla::sorter<T>::sorter(const uint32 jobs, const sortopts& opts)
+	: jobs(jobs), opts(opts), err(0), text(0), text_cap(0), len(0)
+{
+	if (jobs < JobsMin || jobs > JobsMax) {
+		throw std::runtime_error("concurrency level not in accepted range");
+	}
+
+	// Arrays are reused from own pool unless placed specially
+	this->opts.pooled = !(opts.interleave || opts.hugepages);
+	this->opts.pool = &pool;
+	this->opts.sa_file.clear();
+	this->opts.lcp_file.clear();
+	this->opts.checkpoint.clear();
+	this->opts.text_count = 0;
+}
+
+template <typename T>
+tupla::sorter<T>::~sorter()
+{
+	// Arrays are released to pool, which frees them
+	impl.reset();
+	delete [] text;
+}
+
+template <typename T>
+const T * tupla::sorter<T>::sort(const char * in, const size_t n)
+{
+	if (n >= index_traits<T>::MaxInput) {
+		throw std::runtime_error("input too large for index type");
+	}
+
+	// Grow text buffer, keeping it for smaller texts
+	if (text == 0 || n > text_cap) {
+		delete [] text;
+		text = 0;
+		text = new char[n + 1 + TextPadding];
+		text_cap = n;
+	}
+	memcpy(text, in, n);
+	memset(text + n, 0, 1 + TextPadding);
+	len = n + 1;
+
+	if (!impl) impl.reset( suffixsort<T>::instance(text, len, jobs, err, opts) );
+	else impl->reset(text, len);
+
+	impl->build_sa();
+	return impl->get_sa();
+}
+
+template <typename T>
+const T * tupla::sorter<T>::lcp()
+{
+	if (!impl) {
+		throw std::runtime_error("suffix array not complete");
+	}
+
+	impl->build_lcp();
+	return impl->get_lcp();
+}
+
+template class tupla::sorter<uint32>;
+template class tupla::sorter<uint64>;
+template class tupla::sorter<uint40>;
+
+// C interface
+
+struct tupla_sorter {
+	std::unique_ptr< sorter<uint32> > impl;
+	std::string error;
+};
+
+tupla_sorter * tupla_sorter_new(unsigned jobs, const char * algorithm)
+{
+	try {
+		sortopts opts;
+		if (algorithm != 0) opts.algorithm = algorithm;
+		if (opts.algorithm != AlgorithmDoubling 
+				&& opts.algorithm != AlgorithmInduced) return 0;
+
+		std::unique_ptr<tupla_sorter> s( new tupla_sorter() );
+		s->impl.reset( new sorter<uint32>(jobs, opts) );
+		return s.release();
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+void tupla_sorter_free(tupla_sorter * s)
+{
+	delete s;
+}
+
+int tupla_sort(tupla_sorter * s, const char * text, size_t len,
+		const uint32_t ** sa)
+{
+	try {
+		*sa = s->impl->sort(text, len);
+		return 0;
+	}
+	catch (std::exception& e) {
+		s->error = e.what();
+		return -1;
+	}
+}
+
+int tupla_lcp(tupla_sorter * s, const uint32_t ** lcp)
+{
+	try {
+		*lcp = s->impl->lcp();
+		return 0;
+	}
+	catch (std::exception& e) {
+		s->error = e.what();
+		return -1;
+	}
+}
+
+const char * tupla_error(const tupla_sorter * s)
+{
+	return s->error.c_str();
+}
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,46 @@
+/**
+ * C interface of the tupla library. A sorter is created once and sorts
+ * any number of texts, reusing its threads and arrays. Suffix and LCP
+ * arrays have 32-bit entries, so texts are limited to 2 GiB.
+ *
+ * @author jkataja
+ */
+
+#ifndef LIBTUPLA_H
+#define LIBTUPLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tupla_sorter tupla_sorter;
+
+/* Create sorter running jobs threads with algorithm "doubling" or "sais",
+ * or null algorithm for default. Sorter may be used from any thread, one
+ * thread at a time. Returns null on failure. */
+tupla_sorter * tupla_sorter_new(unsigned jobs, const char * algorithm);
+
+/* Release sorter and its arrays. */
+void tupla_sorter_free(tupla_sorter * s);
+
+/* Sort suffixes of text of len bytes without nulls. Sets sa to suffix
+ * array of len+1 entries, valid until next sort. Returns 0 on success. */
+int tupla_sort(tupla_sorter * s, const char * text, size_t len,
+		const uint32_t ** sa);
+
+/* Set lcp to LCP array of last sorted text. Returns 0 on success. */
+int tupla_lcp(tupla_sorter * s, const uint32_t ** lcp);
+
+/* Message of last failure of sorter. */
+const char * tupla_error(const tupla_sorter * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* vim:set ts=4 sts=4 sw=4 noexpandtab: */
@@ -0,0 +1,63 @@
+/**
+ * Library interface for sorting many texts in one process. A sorter
+ * keeps its threads and releases its arrays to its own buffer pool after
+ * each text, so sorting the next text reuses them without allocating.
+ * The pool is freed with the sorter. Any thread may sort, one at a time.
+ * Texts are copied to a reused buffer with terminator and padding, so
+ * any byte string without nulls can be sorted.
+ *
+ * Template parameter T is the index type of suffix and LCP arrays.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+
+#include "numdefs.hpp"
+#include "index.hpp"
+#include "tupla.hpp"
+#include "memory.hpp"
+
+namespace tupla {
+
+template <typename T> class suffixsort;
+
+template <typename T = uint32>
+class sorter {
+
+private:
+	sorter(const sorter&);
+	sorter& operator=(const sorter&);
+
+	const uint32 jobs; // Threads for sorting
+	sortopts opts; // Tuning options of sorter
+	std::ostream err; // Messages are discarded
+
+	char * text; // Text with terminator and padding
+	size_t text_cap; // Bytes of text before terminator and padding
+	size_t len; // Length of text with terminator
+
+	buffer_pool pool; // Arrays of sorter kept between texts
+	std::unique_ptr< suffixsort<T> > impl;
+
+public:
+	sorter(const uint32, const sortopts& = sortopts());
+	~sorter();
+
+	// Sort suffixes of text of n bytes. Returns suffix array of n+1
+	// entries, the first being the terminator, valid until next sort
+	const T * sort(const char *, const size_t);
+
+	// LCP array of last sorted text, valid until next sort
+	const T * lcp();
+
+	// Entries in arrays of last sorted text
+	size_t size() const { return len; }
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
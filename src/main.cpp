@@ -8,6 +8,9 @@
 #include <fstream>
 #include <stdexcept>
 #include <memory>
+#include <unistd.h>
+#include <fcntl.h>
+#include <exception>
 #include <sys/stat.h>
 #include <boost/program_options.hpp>
 #include <boost/format.hpp>
@@ -16,6 +19,9 @@
 
 #include "tupla.hpp"
 #include "suffixsort.hpp"
+#include "extsort.hpp"
+#include "batch.hpp"
+#include "stats.hpp"
 
 namespace po = boost::program_options;
 
@@ -25,6 +31,121 @@ using namespace tupla;
 	"Parallel suffix sorting in shared memory.\n" \
 	"\n"
 
+// Sort text and write output files using index type T
+template <typename T>
+void run_sorter(const char * text_eof, const size_t len_eof,
+		po::variables_map& vm, const std::string& out_sa_name,
+		const std::string& out_lcp_name, const size_t * text_count,
+		const std::string& checkpoint_name, sortstats * stats)
+{
+	sortopts opts;
+	opts.algorithm = vm["algorithm"].as<std::string>();
+	opts.gather = vm.count("gather");
+	opts.text_count = text_count;
+	opts.checkpoint = checkpoint_name;
+	opts.resume = vm.count("resume");
+	opts.interleave = vm.count("interleave");
+	opts.hugepages = vm.count("hugepages");
+	opts.pin = vm.count("pin");
+	opts.stats = stats;
+
+	// Build arrays in mappings of output files
+	bool direct = (vm.count("direct") && !vm.count("benchmark"));
+	if (direct) {
+		opts.sa_file = out_sa_name;
+		if (vm.count("lcp")) opts.lcp_file = out_lcp_name;
+	}
+
+	std::unique_ptr< suffixsort<T> > sorter( suffixsort<T>::instance(
+			text_eof, len_eof, vm["jobs"].as<uint32>(), std::cerr, opts) );
+
+	sorter->build_sa();
+
+	// Pipelined output writes suffix array in another thread while LCP
+	// array is computed, mapped suffix array is written back from cache
+	std::unique_ptr<boost::thread> sa_writer;
+	std::exception_ptr sa_error;
+	bool pipeline = (vm.count("pipeline") && vm.count("lcp")
+			&& !vm.count("benchmark"));
+	if (pipeline) {
+		sa_writer.reset( new boost::thread( [&]() {
+			try {
+				if (direct) sync_array(sorter->get_sa());
+				else write_index_array(sorter->get_sa(), len_eof, out_sa_name);
+			}
+			catch (...) {
+				sa_error = std::current_exception();
+			}
+		} ) );
+	}
+
+	// Compute LCP array from completed SA
+	if (vm.count("lcp")) {
+		stats_clock lcp_start;
+		sorter->build_lcp();
+		if (stats) stats->add_phase("lcp", lcp_start);
+	}
+
+	// Run cross-validation test
+	if (vm.count("validate")) {
+		sorter->out_validate();
+	}
+
+	// Output completed suffix array
+	if (vm.count("output")) {
+		if (vm.count("lcp")) sorter->out_lcp();
+		else sorter->out_sa();
+	}
+
+	// Wait for suffix array written during LCP computation
+	stats_clock write_start;
+	if (pipeline) {
+		sa_writer->join();
+		if (sa_error) std::rethrow_exception(sa_error);
+	}
+
+	// Output suffix array to file
+	if (!vm.count("benchmark") && !direct) {
+		if (!pipeline) write_index_array(sorter->get_sa(), len_eof, out_sa_name);
+
+		if (vm.count("lcp")) {
+			write_index_array(sorter->get_lcp(), len_eof, out_lcp_name);
+		}
+		if (stats) stats->add_phase("write", write_start);
+	}
+
+	// Write back mapped output before sorter unmaps it, so write is timed
+	if (direct) {
+		if (!pipeline) sync_array(sorter->get_sa());
+		if (vm.count("lcp")) sync_array(sorter->get_lcp());
+		if (stats) stats->add_phase("write", write_start);
+	}
+
+	// Output is complete, checkpoint is no longer needed
+	if (!checkpoint_name.empty()) {
+		std::remove(checkpoint_name.c_str());
+	}
+}
+
+// Sort text in blocks fitting memory limit and merge to output file
+template <typename T>
+void run_external(const char * text_eof, const size_t len_eof,
+		po::variables_map& vm, const std::string& out_sa_name)
+{
+	sortopts opts;
+	opts.algorithm = vm["algorithm"].as<std::string>();
+	opts.gather = vm.count("gather");
+	opts.interleave = vm.count("interleave");
+	opts.hugepages = vm.count("hugepages");
+	opts.pin = vm.count("pin");
+
+	extsort<T> sorter(text_eof, len_eof, vm["jobs"].as<uint32>(), std::cerr,
+			opts, (vm["memory"].as<uint64>() << 20));
+
+	sorter.build_sa(out_sa_name, 
+			(vm.count("benchmark") ? std::string() : out_sa_name));
+}
+
 int main(int argc, char** argv) 
 {
 	// Hardware threads available
@@ -38,21 +159,49 @@ int main(int argc, char** argv)
 		std::string jobs_str( boost::str( boost::format(
 			"Allow arg threads to run simultaneously [%1%,%2%]") % JobsMin % JobsMax));
 
+		std::string algorithm_str( boost::str( boost::format(
+			"Suffix sorting algorithm: %1% or %2%") 
+			% AlgorithmDoubling % AlgorithmInduced));
+
 		po::options_description visible_opts("Options");
 		visible_opts.add_options()
+			( "algorithm,a",
+			  po::value<std::string>()->default_value(AlgorithmDoubling),
+			  algorithm_str.c_str()
+			)
 			( "benchmark,b", "Do not output file(s)" )
+			( "batch,B", "Sort each file in input directory or list of files" )
+			( "checkpoint,c", "Save sorting state after each doubling round" )
+			( "direct,d", "Build arrays directly in mapped output files" )
 			( "force,f", "Force overwrite of existing output" )
+			( "gather,g", "Sort doubling keys gathered to contiguous buffer" )
 			( "help,h", "Show this help and exit" )
+			( "hugepages,H", "Back arrays with huge pages when available" )
+			( "interleave,I", "Interleave arrays over NUMA memory nodes" )
+			( "index-bits,i",
+			  po::value<uint32>()->default_value(IndexBitsAuto, ""),
+			  "Width of output indices: 32, 40 or 64 (default by input size)"
+			)
 			( "jobs,j",
 			  po::value<uint32>()->default_value(hardware_jobs),
 			  jobs_str.c_str()
 			)
 			( "lcp,l", "Compute Longest Common Prefix array" )
+			( "mmap,m", "Sort input mapped from file without copying" )
+			( "memory,M", po::value<uint64>(),
+			  "Sort in blocks fitting arg MiB and merge on disk" )
 			( "count,n", 
-			  po::value<uint32>()->default_value(MaxInput, ""),
+			  po::value<uint64>()->default_value(MaxInput, ""),
 			  "Stop processing input after arg bytes" 
 			)
 			( "output,o", "Print generated suffix array to stderr" )
+			( "pin,P", "Pin worker threads to processors" )
+			( "resume,r", "Resume sorting from saved state, then save rounds" )
+			( "stats,S", po::value<std::string>(),
+			  "Print timing and counters of phases to stdout in format "
+			  "arg: json" )
+			( "pipeline,p", "Count input while reading and write suffix "
+			  "array while computing LCP array" )
 			( "validate,v", "Validate generated suffix array (slow)" )
 			;
 
@@ -82,6 +231,15 @@ int main(int argc, char** argv)
 			return EXIT_FAILURE;
 		}
 
+		// Index width
+		uint32 index_bits = vm["index-bits"].as<uint32>();
+		if (index_bits != IndexBitsAuto && index_bits != 32
+				&& index_bits != 40 && index_bits != 64) {
+			std::cerr << SELF << ": index width must be 32, 40 or 64"
+					<< std::endl;
+			return EXIT_FAILURE;
+		}
+
 		// No input
 		if (!vm.count("input-file")) {
 			std::cerr << SELF << ": no input" << std::endl;
@@ -93,12 +251,92 @@ int main(int argc, char** argv)
 			return EXIT_FAILURE;
 		}
 
+		// Statistics of single sort
+		std::unique_ptr<sortstats> stats;
+		if (vm.count("stats")) {
+			if (vm["stats"].as<std::string>() != "json") {
+				std::cerr << SELF << ": statistics format must be json"
+						<< std::endl << std::flush;
+				return EXIT_FAILURE;
+			}
+			if (vm.count("batch") || vm.count("memory")) {
+				std::cerr << SELF << ": option --stats does not support "
+						<< "--batch or --memory" << std::endl << std::flush;
+				return EXIT_FAILURE;
+			}
+			stats.reset( new sortstats() );
+		}
+
+		// Input from standard input when named -
+		std::string in_name( vm["input-file"].as<std::string>() );
+
+		// Many inputs sorted concurrently with pooled arrays
+		if (vm.count("batch")) {
+			if (vm.count("direct") || vm.count("memory") 
+					|| vm.count("checkpoint") || vm.count("resume")) {
+				std::cerr << SELF << ": option --batch does not support "
+						<< "--direct, --memory or checkpoints" 
+						<< std::endl << std::flush;
+				return EXIT_FAILURE;
+			}
+
+			sortopts opts;
+			opts.algorithm = vm["algorithm"].as<std::string>();
+			opts.gather = vm.count("gather");
+			opts.interleave = vm.count("interleave");
+			opts.hugepages = vm.count("hugepages");
+			opts.pin = vm.count("pin");
+			opts.pooled = !(opts.interleave || opts.hugepages);
+
+			batchopts bopts;
+			bopts.lcp = vm.count("lcp");
+			bopts.write = !vm.count("benchmark");
+			bopts.force = vm.count("force");
+			bopts.index_bits = index_bits;
+
+			batchsort batch(vm["jobs"].as<uint32>(), std::cerr, opts, bopts);
+			size_t failed = batch.run( batchsort::list_inputs(in_name) );
+
+			std::cerr << SELF << ": done" << std::endl;
+			return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		bool stream = (in_name == StreamInput);
+		if (stream && vm.count("mmap")) {
+			std::cerr << SELF << ": cannot map standard input" 
+					<< std::endl << std::flush;
+			return EXIT_FAILURE;
+		}
+
+		// External sort reads input mapped and writes only suffix array
+		bool external = vm.count("memory");
+		if (external && (stream || vm.count("lcp") || vm.count("direct"))) {
+			std::cerr << SELF << ": option --memory needs input file and "
+					<< "does not support --lcp or --direct" 
+					<< std::endl << std::flush;
+			return EXIT_FAILURE;
+		}
+
 		// Output filenames
+		std::string out_base(stream ? StreamOutput : in_name);
 		std::string out_sa_name(boost::str( boost::format("%1%.%2%") 
-				% vm["input-file"].as<std::string>() % RankFileSuffix ) );
+				% out_base % RankFileSuffix ) );
 
 		std::string out_lcp_name(boost::str( boost::format("%1%.%2%") 
-				% vm["input-file"].as<std::string>() % LCPFileSuffix ) );
+				% out_base % LCPFileSuffix ) );
+
+		// Checkpoints of doubling rounds
+		std::string checkpoint_name;
+		if (vm.count("checkpoint") || vm.count("resume")) {
+			if (vm["algorithm"].as<std::string>() != AlgorithmDoubling
+					|| vm.count("direct") || vm.count("memory")) {
+				std::cerr << SELF << ": checkpoints need doubling algorithm "
+						<< "and do not support --direct or --memory" 
+						<< std::endl << std::flush;
+				return EXIT_FAILURE;
+			}
+			checkpoint_name = boost::str( boost::format("%1%.%2%") 
+					% out_base % CheckpointFileSuffix );
+		}
 
 		// Output already exists
 		if (!vm.count("benchmark") && !vm.count("force")) {
@@ -119,63 +357,110 @@ int main(int argc, char** argv)
 			}
 		}
 		
-		// Read input text file
-		std::string in_name( vm["input-file"].as<std::string>() );
-		// Type limits
-		long in_filesize = stat_filesize(in_name);
-		if ((size_t)in_filesize > MaxInput) {
-			std::cerr << SELF << ": input file too large (max 2 GiB)" 
-					<< std::endl << std::flush;
-			return EXIT_FAILURE;
-		}
-		uint32 len = (uint32)in_filesize;
-
 		// Limit input bytes to read
-		if (vm.count("count")) {
-			uint32 maxcount = vm["count"].as<uint32>();
-			if (maxcount < len) len = std::min(len, maxcount);
+		uint64 maxcount = vm["count"].as<uint64>();
+
+		// Read standard input to end, counting characters while reading,
+		// one byte past limit to detect too large input
+		char * text_eof = 0;
+		size_t text_count[Alpha] = { Z256 };
+		size_t len = 0;
+		stats_clock read_start;
+		if (stream) {
+			text_eof = (char *)read_stream_string(STDIN_FILENO, 
+					std::min(maxcount, (uint64)MaxInput + 1), len, text_count);
+		}
+		else {
+			len = (size_t)stat_filesize(in_name);
+			if (maxcount < len) len = maxcount;
 		}
-		uint32 len_eof = len + 1;
-
-		// TODO read from stdin
-		char * text_eof = (char *)read_byte_string(in_name, len);
-
-		std::unique_ptr<suffixsort> sorter( suffixsort::instance( text_eof,
-				len_eof, vm["jobs"].as<uint32>(), std::cerr) );
 
-		sorter->build_sa();
+		// Pipelined input is read from file like a stream
+		bool mapped = (vm.count("mmap") || external);
+		bool counted = (stream || (vm.count("pipeline") && !mapped));
+		if (counted && !stream && len <= MaxInput) {
+			int fd = open(in_name.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("could not open input file");
+			}
+			size_t read_len = 0;
+			text_eof = (char *)read_stream_string(fd, len, read_len, text_count);
+			close(fd);
+			if (read_len != len) {
+				delete [] text_eof;
+				throw std::runtime_error("attempt to read past input");
+			}
+		}
 
-		// Compute LCP array from completed SA
-		if (vm.count("lcp")) {
-			sorter->build_lcp();
+		if (len > MaxInput) {
+			std::cerr << SELF << ": input file too large" 
+					<< std::endl << std::flush;
+			return EXIT_FAILURE;
 		}
 
-		// Run cross-validation test
-		if (vm.count("validate")) {
-			sorter->out_validate();
+		// Small inputs default to 32-bit indices, large to packed 40-bit
+		if (index_bits == IndexBitsAuto) {
+			index_bits = (len <= index_traits<uint32>::MaxInput ? 32
+					: (len <= index_traits<uint40>::MaxInput ? 40 : 64));
 		}
+		if (index_bits == 32 && len > index_traits<uint32>::MaxInput) {
+			std::cerr << SELF << ": input file too large for 32-bit indices" 
+					<< " (max 2 GiB)" << std::endl << std::flush;
+			return EXIT_FAILURE;
+		}
+		if (index_bits == 40 && len > index_traits<uint40>::MaxInput) {
+			std::cerr << SELF << ": input file too large for 40-bit indices" 
+					<< " (max 512 GiB)" << std::endl << std::flush;
+			return EXIT_FAILURE;
+		}
+		size_t len_eof = len + 1;
 
-		// Output completed suffix array
-		if (vm.count("output")) {
-			if (vm.count("lcp")) sorter->out_lcp();
-			else sorter->out_sa();
+		// Read input text file
+		if (!counted) {
+			text_eof = (char *)(mapped
+					? map_byte_string(in_name, len) 
+					: read_byte_string(in_name, len));
+		}
+		if (stats) {
+			stats->add_phase("read", read_start);
+			stats->set("input", in_name);
+			stats->set("algorithm", vm["algorithm"].as<std::string>());
+			stats->set("length", (uint64)len_eof);
+			stats->set("jobs", (uint64)vm["jobs"].as<uint32>());
+			stats->set("index_bits", (uint64)index_bits);
 		}
 
-		// Output suffix array to file
-		if (!vm.count("benchmark")) {
-			const size_t len_bytes = ((len_eof) * sizeof(uint32));
-			const uint32 * const sa = sorter->get_sa();
-			write_byte_string(sa, len_bytes, out_sa_name);
+		if (external) {
+			if (index_bits == 32)
+				run_external<uint32>(text_eof, len_eof, vm, out_sa_name);
+			else if (index_bits == 40)
+				run_external<uint40>(text_eof, len_eof, vm, out_sa_name);
+			else
+				run_external<uint64>(text_eof, len_eof, vm, out_sa_name);
+		}
+		else if (index_bits == 32) {
+			run_sorter<uint32>(text_eof, len_eof, vm, out_sa_name,
+					out_lcp_name, (counted ? text_count : 0), checkpoint_name, stats.get());
+		}
+		else if (index_bits == 40) {
+			run_sorter<uint40>(text_eof, len_eof, vm, out_sa_name,
+					out_lcp_name, (counted ? text_count : 0), checkpoint_name, stats.get());
+		}
+		else {
+			run_sorter<uint64>(text_eof, len_eof, vm, out_sa_name,
+					out_lcp_name, (counted ? text_count : 0), checkpoint_name, stats.get());
+		}
 
-			if (vm.count("lcp")) {
-				const uint32 * const lcp = sorter->get_lcp();
-				write_byte_string(lcp, len_bytes, out_lcp_name);
-			}
+		if (stats) {
+			stats->set("bytes_allocated", allocated_bytes());
+			stats->set("allocations", allocation_count());
+			stats->write_json(std::cout);
 		}
 
 		std::cerr << SELF << ": done" << std::endl;
 
-		delete [] text_eof;
+		if (mapped) unmap_byte_string(text_eof, len);
+		else delete [] text_eof;
 	}
 	catch (std::exception& e) {
 		std::cerr << SELF << ": " << e.what() << std::endl << std::flush;
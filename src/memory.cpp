@@ -0,0 +1,334 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "memory.hpp"
+
+using namespace tupla;
+
+// Memory policy constants, without depending on libnuma headers
+static const int PolicyInterleave = 3; // MPOL_INTERLEAVE
+static const unsigned long PolicyMemsAllowed = 4; // MPOL_F_MEMS_ALLOWED
+
+// Huge page sizes and their size flags for MAP_HUGETLB
+static const size_t HugePage = (1 << 21);
+static const size_t GiantPage = (1 << 30);
+static const int HugePageShift = 26; // MAP_HUGE_SHIFT
+
+// Pages backing mapped allocation
+enum page_kind {
+	PagesNormal,
+	PagesTransparent, // Normal pages advised to be merged to huge pages
+	PagesHuge,
+	PagesGiant,
+	PagesFile
+};
+
+struct mapping {
+	size_t length; // Bytes mapped
+	page_kind kind;
+};
+
+// Mapped allocations
+static std::map<void *, mapping> mapped;
+static boost::mutex mapped_lock;
+
+// Pooled heap buffer with its capacity and pool, null if its pool was
+// destroyed while buffer was in use
+struct pooled_buffer {
+	size_t cap;
+	buffer_pool * pool;
+};
+
+// Pooled heap buffers of all pools by address, and the shared pool
+static std::map<void *, pooled_buffer> pooled;
+static boost::mutex pool_lock;
+static buffer_pool shared_pool;
+
+// Allocations requested
+static std::atomic<uint64> requested_bytes(0);
+static std::atomic<uint64> requested_count(0);
+
+// Smallest pooled buffer size, sizes are powers of two
+static const size_t PoolMinimum = (1 << 12);
+
+void * tupla::buffer_pool::acquire(size_t bytes)
+{
+	size_t cap = PoolMinimum;
+	while (cap < bytes) cap <<= 1;
+
+	boost::mutex::scoped_lock lock(pool_lock);
+	std::multimap<size_t, void *>::iterator it = idle.find(cap);
+	if (it != idle.end()) {
+		void * data = it->second;
+		idle.erase(it);
+		return data;
+	}
+
+	void * data = new char[cap];
+	pooled[data] = pooled_buffer{ cap, this };
+	return data;
+}
+
+void tupla::buffer_pool::release()
+{
+	boost::mutex::scoped_lock lock(pool_lock);
+	for (auto i : idle) {
+		pooled.erase(i.second);
+		delete [] (char *)i.second;
+	}
+	idle.clear();
+}
+
+tupla::buffer_pool::~buffer_pool()
+{
+	release();
+
+	// Buffers still in use are freed when released
+	boost::mutex::scoped_lock lock(pool_lock);
+	for (auto& p : pooled)
+		if (p.second.pool == this) p.second.pool = 0;
+}
+
+// Interleave pages of range over memory nodes allowed for process,
+// default policy is kept where policies are not supported
+static void interleave_pages(void * data, size_t bytes)
+{
+	unsigned long mask[16] = { 0 };
+	const unsigned long maxnode = (sizeof(mask) * 8);
+	int mode = 0;
+	if (syscall(SYS_get_mempolicy, &mode, mask, maxnode, 0, 
+			PolicyMemsAllowed) != 0) return;
+	syscall(SYS_mbind, data, bytes, PolicyInterleave, mask, maxnode, 0);
+}
+
+// Map anonymous memory from pool of explicit huge pages of size page,
+// or null if pool is exhausted or not configured
+static void * map_huge(size_t& length, size_t page)
+{
+	size_t huge_length = ((length + page - 1) / page) * page;
+	int shift = (page == GiantPage ? 30 : 21);
+	void * data = mmap(0, huge_length, (PROT_READ | PROT_WRITE), 
+			(MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB 
+			 | (shift << HugePageShift)), -1, 0);
+	if (data == MAP_FAILED) return 0;
+
+	length = huge_length;
+	return data;
+}
+
+// Map anonymous memory aligned to huge page, advised to be backed by
+// transparent huge pages
+static void * map_transparent(size_t& length, page_kind& kind)
+{
+	size_t huge_length = ((length + HugePage - 1) / HugePage) * HugePage;
+	char * base = (char *)mmap(0, (huge_length + HugePage),
+			(PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+	if (base == MAP_FAILED) return 0;
+
+	// Trim mapping to aligned start
+	size_t head = ((HugePage - ((size_t)base & (HugePage - 1))) 
+			& (HugePage - 1));
+	if (head > 0) munmap(base, head);
+	munmap((base + head + huge_length), (HugePage - head));
+
+	char * data = base + head;
+	length = huge_length;
+	kind = (madvise(data, length, MADV_HUGEPAGE) == 0 
+			? PagesTransparent : PagesNormal);
+	return data;
+}
+
+void * tupla::alloc_bytes(const size_t bytes, const std::string& filename,
+		const uint32 flags, buffer_pool * pool)
+{
+	requested_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	requested_count.fetch_add(1, std::memory_order_relaxed);
+
+	if (bytes == 0 || (filename.empty() && flags == 0)) 
+		return new char[bytes];
+
+	if (filename.empty() && flags == AllocPooled)
+		return (pool != 0 ? pool : &shared_pool)->acquire(bytes);
+
+	void * data = 0;
+	mapping m = { bytes, PagesNormal };
+	if (filename.empty()) {
+		// Giant pages for arrays of at least giant page, then huge pages,
+		// then transparent huge pages
+		if (flags & AllocHugePages) {
+			if (bytes >= GiantPage && (data = map_huge(m.length, GiantPage)))
+				m.kind = PagesGiant;
+			else if ((data = map_huge(m.length, HugePage)))
+				m.kind = PagesHuge;
+			else 
+				data = map_transparent(m.length, m.kind);
+		}
+		else {
+			data = mmap(0, bytes, (PROT_READ | PROT_WRITE), 
+					(MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+			if (data == MAP_FAILED) data = 0;
+		}
+		if (data == 0) {
+			throw std::runtime_error("could not allocate memory");
+		}
+	}
+	else {
+		int fd = open(filename.c_str(), (O_RDWR | O_CREAT | O_TRUNC), 0666);
+		if (fd < 0) {
+			throw std::runtime_error("could not create output file");
+		}
+		if (ftruncate(fd, bytes) != 0) {
+			close(fd);
+			throw std::runtime_error("could not allocate output file");
+		}
+
+		data = mmap(0, bytes, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			throw std::runtime_error("could not map output file");
+		}
+		m.kind = PagesFile;
+	}
+
+	// Pages are placed on first touch, so policy is set before use
+	if (flags & AllocInterleave) interleave_pages(data, m.length);
+
+	boost::mutex::scoped_lock lock(mapped_lock);
+	mapped[data] = m;
+
+	return data;
+}
+
+void tupla::sync_bytes(const void * data)
+{
+	size_t bytes = 0;
+	{
+		boost::mutex::scoped_lock lock(mapped_lock);
+		std::map<void *, mapping>::iterator it = mapped.find((void *)data);
+		if (it == mapped.end()) return;
+		bytes = it->second.length;
+	}
+
+	if (msync((void *)data, bytes, MS_SYNC) != 0) {
+		throw std::runtime_error("could not write output file");
+	}
+}
+
+void tupla::free_bytes(void * data)
+{
+	if (data == 0) return;
+
+	// Pooled buffer is kept idle in its pool
+	{
+		boost::mutex::scoped_lock lock(pool_lock);
+		std::map<void *, pooled_buffer>::iterator it = pooled.find(data);
+		if (it != pooled.end()) {
+			if (it->second.pool != 0) {
+				it->second.pool->idle.insert(
+						std::make_pair(it->second.cap, data) );
+			}
+			else {
+				pooled.erase(it);
+				delete [] (char *)data;
+			}
+			return;
+		}
+	}
+
+	boost::mutex::scoped_lock lock(mapped_lock);
+	std::map<void *, mapping>::iterator it = mapped.find(data);
+	if (it == mapped.end()) {
+		delete [] (char *)data;
+		return;
+	}
+
+	munmap(data, it->second.length);
+	mapped.erase(it);
+}
+
+uint64 tupla::allocated_bytes()
+{
+	return requested_bytes.load();
+}
+
+uint64 tupla::allocation_count()
+{
+	return requested_count.load();
+}
+
+void tupla::release_pool()
+{
+	shared_pool.release();
+}
+
+uint64 tupla::pooled_bytes()
+{
+	boost::mutex::scoped_lock lock(pool_lock);
+	uint64 bytes = 0;
+	for (auto& p : pooled)
+		bytes += p.second.cap;
+	return bytes;
+}
+
+// Bytes of mapping containing data backed by transparent huge pages,
+// including neighbouring allocations merged to the same mapping
+static size_t transparent_bytes(const void * data)
+{
+	std::ifstream smaps("/proc/self/smaps");
+	std::string line;
+	bool found = false;
+	while (std::getline(smaps, line)) {
+		// Header line of mapping starts with its address range
+		size_t dash = line.find('-');
+		if (dash != std::string::npos && dash > 0 
+				&& line.find(':') > line.find(' ')) {
+			unsigned long long a = (unsigned long long)data;
+			found = (std::stoull(line.substr(0, dash), 0, 16) <= a
+					&& a < std::stoull(line.substr(dash + 1), 0, 16));
+			continue;
+		}
+		if (found && line.compare(0, 14, "AnonHugePages:") == 0) {
+			std::istringstream in(line.substr(14));
+			size_t kb = 0;
+			in >> kb;
+			return (kb << 10);
+		}
+	}
+	return 0;
+}
+
+std::string tupla::describe_pages(const void * data)
+{
+	mapping m = { 0, PagesNormal };
+	{
+		boost::mutex::scoped_lock lock(mapped_lock);
+		std::map<void *, mapping>::iterator it = mapped.find((void *)data);
+		if (it == mapped.end()) return "heap pages";
+		m = it->second;
+	}
+
+	switch (m.kind) {
+		case PagesGiant: return "1 GiB huge pages";
+		case PagesHuge: return "2 MiB huge pages";
+		case PagesFile: return "pages of output file";
+		case PagesTransparent:
+			return boost::str( boost::format(
+					"transparent huge pages for %1% of %2% MiB") 
+					% (std::min(transparent_bytes(data), m.length) >> 20) 
+					% (m.length >> 20) );
+		default: return "normal pages";
+	}
+}
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,104 @@
+/**
+ * Allocation of index arrays. Arrays are allocated from heap, or in a
+ * shared mapping of an output file so that the finished array is the
+ * output and the page cache writes it back without copying. Large
+ * arrays may be interleaved over NUMA memory nodes, and backed by huge
+ * pages to reduce TLB misses of random lookups. Pooled heap memory is
+ * kept for reuse when released, so sorting many small inputs does not
+ * allocate arrays for each input. Memory is pooled in the shared pool,
+ * or in a pool owned by one sorter that frees it when destroyed.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstddef>
+
+#include "numdefs.hpp"
+
+namespace tupla {
+
+// Allocation flags
+enum alloc_flag {
+	AllocInterleave = 1, // Spread pages over memory nodes of the system
+	AllocHugePages = 2,  // Back with huge pages when available
+	AllocPooled = 4      // Reuse heap memory released to buffer pool
+};
+
+// Heap buffers kept for reuse, idle buffers are freed with the pool
+class buffer_pool {
+
+public:
+	buffer_pool() { }
+	~buffer_pool();
+
+	// Free idle buffers
+	void release();
+
+	// Take idle buffer of at least bytes, or allocate new one
+	void * acquire(size_t);
+
+private:
+	buffer_pool(const buffer_pool&);
+	buffer_pool& operator=(const buffer_pool&);
+
+	// Idle buffers by capacity
+	std::multimap<size_t, void *> idle;
+
+	friend void free_bytes(void *);
+};
+
+// Allocate bytes from heap, or mapped to file created with that size
+// when filename is not empty. Memory with flags set is mapped, except
+// pooled memory taken from pool or the shared pool if none
+void * alloc_bytes(const size_t, const std::string&, const uint32 = 0,
+		buffer_pool * = 0);
+
+// Write back memory mapped to file, memory from heap is ignored
+void sync_bytes(const void *);
+
+// Release memory from alloc_bytes
+void free_bytes(void *);
+
+// Free idle heap memory held in shared buffer pool
+void release_pool();
+
+// Bytes of heap buffers held in all pools, idle or in use
+uint64 pooled_bytes();
+
+// Description of pages backing memory from alloc_bytes
+std::string describe_pages(const void *);
+
+// Bytes and number of allocations requested from alloc_bytes, including
+// those served from buffer pool
+uint64 allocated_bytes();
+uint64 allocation_count();
+
+// Allocate array of n indices, mapped to file when filename is not empty
+template <typename T>
+T * alloc_array(const size_t n, const std::string& filename = std::string(),
+		const uint32 flags = 0, buffer_pool * pool = 0)
+{
+	return (T *)alloc_bytes((n * sizeof(T)), filename, flags, pool);
+}
+
+// Write back array mapped to file
+template <typename T>
+void sync_array(const T * data)
+{
+	sync_bytes((const void *)data);
+}
+
+// Release array from alloc_array
+template <typename T>
+void free_array(T * data)
+{
+	free_bytes((void *)data);
+}
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
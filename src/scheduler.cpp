@@ -0,0 +1,261 @@
+#include "scheduler.hpp"
+
+#include <boost/bind.hpp>
+#include <sched.h>
+#include <vector>
+
+using namespace tupla;
+
+// Scheduler and worker index of thread started by scheduler
+static __thread scheduler * current_scheduler = 0;
+static __thread uint32 current_worker = 0;
+
+tupla::scheduler::scheduler(uint32 workers, bool pinned)
+	: workers(workers), pinned(pinned), caller(0), injected_size(0),
+	  pending(0), scheduled(0), sleeping(0), stopping(false)
+{
+	for (size_t j = 0 ; j < workers ; ++j)
+		deques.push_back(new worker_deque());
+
+	for (size_t j = 1 ; j < workers ; ++j)
+		threads.create_thread( boost::bind(&tupla::scheduler::work, this, j) );
+}
+
+tupla::scheduler::~scheduler()
+{
+	stopping.store(true);
+	sleep_lock.lock();
+	sleep_cond.notify_all();
+	sleep_lock.unlock();
+
+	threads.join_all();
+}
+
+void tupla::scheduler::pin(uint32 j)
+{
+	static cpu_set_t allowed;
+	static bool allowed_read = false;
+	static boost::mutex allowed_lock;
+
+	// Processors allowed before any thread was pinned
+	std::vector<int> cpus;
+	{
+		boost::mutex::scoped_lock lock(allowed_lock);
+		if (!allowed_read) {
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+			allowed_read = true;
+		}
+		for (int c = 0 ; c < CPU_SETSIZE ; ++c)
+			if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+	}
+	if (cpus.empty()) return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpus[j % cpus.size()], &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+uint32 tupla::scheduler::self()
+{
+	if (current_scheduler == this) return current_worker;
+	return (pthread_equal(caller.load(), pthread_self()) ? 0 : workers);
+}
+
+bool tupla::scheduler::enter()
+{
+	if (self() < workers) return false;
+
+	pthread_t none = 0;
+	return caller.compare_exchange_strong(none, pthread_self());
+}
+
+void tupla::scheduler::leave()
+{
+	caller.store(0);
+}
+
+bool tupla::scheduler::push(uint32 j, const task& t)
+{
+	worker_deque& d = deques[j];
+	const long b = d.bottom.load(std::memory_order_relaxed);
+	const long top = d.top.load(std::memory_order_acquire);
+	if (b - top >= (long)DequeSize) return false;
+
+	d.tasks[b & (DequeSize - 1)] = t;
+	d.bottom.store(b + 1);
+	return true;
+}
+
+bool tupla::scheduler::pop(uint32 j, task& t)
+{
+	worker_deque& d = deques[j];
+	const long b = d.bottom.load(std::memory_order_relaxed) - 1;
+	d.bottom.store(b);
+	long top = d.top.load();
+
+	// Deque was empty
+	if (top > b) {
+		d.bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	t = d.tasks[b & (DequeSize - 1)];
+	if (top < b) return true;
+
+	// Last task, race against thieves
+	bool won = d.top.compare_exchange_strong(top, top + 1);
+	d.bottom.store(b + 1, std::memory_order_relaxed);
+	return won;
+}
+
+bool tupla::scheduler::steal(uint32 j, task& t)
+{
+	worker_deque& d = deques[j];
+	long top = d.top.load();
+	const long b = d.bottom.load();
+	if (top >= b) return false;
+
+	// Task is read before claiming, owner may overwrite it afterwards
+	t = d.tasks[top & (DequeSize - 1)];
+	return d.top.compare_exchange_strong(top, top + 1);
+}
+
+void tupla::scheduler::place(uint32 j, const task& t)
+{
+	pending.fetch_add(1);
+	scheduled.fetch_add(1, std::memory_order_relaxed);
+
+	worker_deque& d = deques[j];
+	{
+		boost::mutex::scoped_lock lock(d.placed_lock);
+		d.placed.push_back(t);
+		d.placed_size.fetch_add(1);
+	}
+
+	// Worker of the task may be sleeping
+	if (sleeping.load() > 0) {
+		boost::mutex::scoped_lock lock(sleep_lock);
+		sleep_cond.notify_all();
+	}
+}
+
+bool tupla::scheduler::take_placed(uint32 j, task& t)
+{
+	worker_deque& d = deques[j];
+	if (d.placed_size.load() == 0) return false;
+
+	boost::mutex::scoped_lock lock(d.placed_lock);
+	if (d.placed.empty()) return false;
+	t = d.placed.back();
+	d.placed.pop_back();
+	d.placed_size.fetch_sub(1);
+	return true;
+}
+
+bool tupla::scheduler::find(uint32 j, task& t)
+{
+	if (j < workers && (take_placed(j, t) || pop(j, t))) return true;
+
+	if (injected_size.load() > 0) {
+		boost::mutex::scoped_lock lock(injected_lock);
+		if (!injected.empty()) {
+			t = injected.front();
+			injected.pop_front();
+			injected_size.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Steal starting from next worker
+	for (uint32 i = 1 ; i <= workers ; ++i) {
+		const uint32 v = (j + i) % workers;
+		if (v != j && steal(v, t)) return true;
+	}
+	return false;
+}
+
+bool tupla::scheduler::has_tasks(uint32 j)
+{
+	if (deques[j].placed_size.load() > 0) return true;
+	if (injected_size.load() > 0) return true;
+	for (size_t j = 0 ; j < workers ; ++j)
+		if (deques[j].top.load() < deques[j].bottom.load()) return true;
+	return false;
+}
+
+void tupla::scheduler::work(uint32 j)
+{
+	current_scheduler = this;
+	current_worker = j;
+	if (pinned) pin(j);
+
+	task t;
+	uint32 fails = 0;
+	while (!stopping.load()) {
+		if (find(j, t)) {
+			run(t);
+			fails = 0;
+			continue;
+		}
+		if (++fails < StealRounds) {
+			boost::this_thread::yield();
+			continue;
+		}
+
+		// Sleep until tasks are scheduled
+		boost::mutex::scoped_lock lock(sleep_lock);
+		sleeping.fetch_add(1);
+		while (!stopping.load() && !has_tasks(j))
+			sleep_cond.wait(lock);
+		sleeping.fetch_sub(1);
+		fails = 0;
+	}
+}
+
+void tupla::scheduler::schedule(task_fun fun, void * obj, size_t p, size_t n)
+{
+	const task t = { fun, obj, p, n };
+	pending.fetch_add(1);
+	scheduled.fetch_add(1, std::memory_order_relaxed);
+
+	const uint32 j = self();
+	if (j < workers) {
+		// Deque is full, run in this thread
+		if (!push(j, t)) {
+			run(t);
+			return;
+		}
+	}
+	else {
+		boost::mutex::scoped_lock lock(injected_lock);
+		injected.push_back(t);
+		injected_size.fetch_add(1);
+	}
+
+	if (sleeping.load() > 0) {
+		boost::mutex::scoped_lock lock(sleep_lock);
+		sleep_cond.notify_one();
+	}
+}
+
+void tupla::scheduler::help(std::atomic<size_t>& remaining)
+{
+	const uint32 j = self();
+
+	task t;
+	while (remaining.load() > 0) {
+		if (find(j, t)) run(t);
+		else boost::this_thread::yield();
+	}
+}
+
+void tupla::scheduler::wait()
+{
+	const bool entered = enter();
+	help(pending);
+	if (entered) leave();
+}
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,234 @@
+/**
+ * Work-stealing task scheduler.
+ *
+ * Each worker owns a deque of tasks, pushing and popping at the bottom
+ * while idle workers steal from the top. Workers 1.. are threads of the
+ * scheduler. A thread waiting for tasks or a loop takes the place of
+ * worker 0 while it waits, so the scheduler may be used from any thread,
+ * one at a time. Tasks are stored by value, so scheduling does not
+ * allocate or lock. Tasks scheduled from other threads go through a
+ * shared queue.
+ *
+ * Workers persist for the lifetime of the scheduler and also run the
+ * shares of data parallel loops, so phases do not create threads. Loops
+ * may place share j on worker j instead of letting it be stolen, so
+ * each worker touches the same chunks of arrays in every phase. Pinned
+ * workers stay on one processor each, so memory they first touch stays
+ * local to them on NUMA systems. Only threads of the scheduler are pinned.
+ *
+ * Based on:
+ * D. Chase & Y. Lev 2005: Dynamic Circular Work-Stealing Deque. SPAA 2005
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "numdefs.hpp"
+
+namespace tupla {
+
+class scheduler {
+
+public:
+	// Task runs function on object for range p..p+n-1
+	typedef void (*task_fun)(void *, size_t, size_t);
+
+	struct task {
+		task_fun fun;
+		void * obj;
+		size_t p;
+		size_t n;
+	};
+
+private:
+	scheduler(const scheduler&);
+	scheduler& operator=(const scheduler&);
+
+	// Tasks in each deque, owner runs tasks inline when full
+	static const size_t DequeSize = (1 << 14);
+
+	// Failed steal rounds before idle worker sleeps
+	static const uint32 StealRounds = 64;
+
+	struct worker_deque {
+		worker_deque() : top(0), bottom(0), placed_size(0) { }
+
+		std::atomic<long> top;
+		std::atomic<long> bottom;
+		task tasks[DequeSize];
+
+		// Tasks placed on this worker, run only by the worker
+		boost::mutex placed_lock;
+		std::vector<task> placed;
+		std::atomic<size_t> placed_size;
+	};
+
+	// Number of workers including the creating thread
+	const uint32 workers;
+
+	// Workers run on fixed processors
+	const bool pinned;
+
+	// Thread outside scheduler acting as worker 0 while it waits, 0 if none
+	std::atomic<pthread_t> caller;
+
+	boost::ptr_vector<worker_deque> deques;
+
+	// Tasks scheduled from threads outside the scheduler
+	std::deque<task> injected;
+	boost::mutex injected_lock;
+	std::atomic<size_t> injected_size;
+
+	// Scheduled tasks not yet finished
+	std::atomic<size_t> pending;
+
+	// Tasks scheduled since creation
+	std::atomic<size_t> scheduled;
+
+	// Idle workers sleep until new tasks are scheduled
+	boost::mutex sleep_lock;
+	boost::condition_variable sleep_cond;
+	std::atomic<uint32> sleeping;
+	std::atomic<bool> stopping;
+
+	boost::thread_group threads;
+
+	// Push task to bottom of own deque, false if full
+	bool push(uint32, const task&);
+
+	// Pop task from bottom of own deque
+	bool pop(uint32, task&);
+
+	// Steal task from top of deque of worker
+	bool steal(uint32, task&);
+
+	// Add task to be run only by worker
+	void place(uint32, const task&);
+
+	// Take task placed on worker
+	bool take_placed(uint32, task&);
+
+	// Take task placed on worker, from own deque, shared queue or other
+	// workers
+	bool find(uint32, task&);
+
+	// Tasks placed on worker, any deque or shared queue may have tasks
+	bool has_tasks(uint32);
+
+	// Run task and mark it finished
+	inline void run(const task& t)
+	{
+		t.fun(t.obj, t.p, t.n);
+		pending.fetch_sub(1);
+	}
+
+	// Worker loop for threads 1..workers-1
+	void work(uint32);
+
+	// Run tasks in calling thread until counter reaches zero
+	void help(std::atomic<size_t>&);
+
+	// Range shared by tasks of parallel_for
+	template <class F>
+	struct share_call {
+		share_call(F fun, size_t p, size_t n, size_t share, size_t shares)
+			: fun(fun), p(p), n(n), share(share), remaining(shares) { }
+
+		F fun;
+		const size_t p;
+		const size_t n;
+		const size_t share;
+		std::atomic<size_t> remaining;
+	};
+
+	// Task running share j of range
+	template <class F>
+	static void share_task(void * obj, size_t j, size_t)
+	{
+		share_call<F> * call = (share_call<F> *)obj;
+		const size_t f = j * call->share;
+		call->fun(call->p + f, std::min(call->share, call->n - f), j);
+		call->remaining.fetch_sub(1);
+	}
+
+	// Worker index of the calling thread, or workers if not a worker
+	uint32 self();
+
+	// Calling thread outside scheduler takes place of worker 0 if free,
+	// false if it did not
+	bool enter();
+
+	// Calling thread leaves place of worker 0
+	void leave();
+
+	// Bind calling thread to processor of worker j, in order of the
+	// processors allowed for the process
+	void pin(uint32 j);
+
+public:
+	scheduler(uint32, bool = false);
+	~scheduler();
+
+	// Add task to run function on object for range p..p+n-1
+	void schedule(task_fun, void *, size_t, size_t);
+
+	// Run tasks in calling thread until all scheduled tasks are finished
+	void wait();
+
+	// Invoke fun(p, n, j) for each share j of range p..p+n-1, returning
+	// when all shares are finished. Calling thread runs the first share
+	// and other tasks while waiting, so loops may nest inside tasks. When
+	// placed, share j runs on worker j modulo workers, and calling worker
+	// runs its own shares.
+	template <class F>
+	void parallel_for(F fun, size_t p, size_t n, size_t share,
+			bool placed = false)
+	{
+		const size_t shares = (n + share - 1) / share;
+		if (shares == 0) return;
+
+		share_call<F> call(fun, p, n, share, shares);
+		const bool entered = enter();
+		const uint32 j = self();
+		for (size_t s = shares ; --s > 0 ; ) {
+			if (!placed) schedule(&share_task<F>, &call, s, 0);
+			else if ((s % workers) != j) {
+				place((s % workers), task{ &share_task<F>, &call, s, 0 });
+			}
+		}
+
+		if (!placed) share_task<F>(&call, 0, 0);
+		else if (j != 0) place(0, task{ &share_task<F>, &call, 0, 0 });
+		if (placed && j < workers) {
+			for (size_t s = j ; s < shares ; s += workers)
+				share_task<F>(&call, s, 0);
+		}
+		help(call.remaining);
+		if (entered) leave();
+	}
+
+	// Number of workers
+	uint32 size() const { return workers; }
+
+	// Number of tasks scheduled since creation
+	size_t tasks() const { return scheduled.load(std::memory_order_relaxed); }
+
+	// Worker index of the calling thread, or size() if not a worker
+	uint32 worker() { return self(); }
+
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -1,33 +1,50 @@
-#include <boost/threadpool.hpp>
 #include <boost/bind.hpp>
+#include <algorithm>
+#include <type_traits>
 
 #include "sortpar.hpp"
 #include "tupla.hpp"
-#include "tqsort_task.hpp"
-#include "doubling_task.hpp"
 
 using namespace tupla;
 
-tupla::sortpar::sortpar(const char * text, const uint32 len, const uint32 jobs,
-		std::ostream& err)
-	: suffixsort(text, len, err), isa_assign(0), jobs(jobs), 
-	  chunk( std::min( std::max(BucketSize, (len/jobs) + 1) , len) )
+template <typename T>
+tupla::sortpar<T>::sortpar(const char * text, const size_t len, 
+		const uint32 jobs, std::ostream& err, const sortopts& opts)
+	: suffixsort<T>(text, len, err, opts), isa_assign(0), patch(0),
+	  patch_len(0), patch_cap(0), patch_overflow(false), jobs(jobs), 
+	  chunk( chunk_length(len) ), sched(jobs, opts.pin)
 {
+	patch_len = new size_t[jobs];
 }
 
-tupla::sortpar::~sortpar()
+template <typename T>
+tupla::sortpar<T>::~sortpar()
 {
-	delete [] isa_assign;
+	free_array(isa_assign);
+	free_array(patch);
+	delete [] patch_len;
 }
 
-uint32 tupla::sortpar::tqsort(uint32 p, size_t n)
+template <typename T>
+void tupla::sortpar<T>::reset(const char * text, const size_t len)
 {
-	uint32 a,b,c,d;
-	uint32 pn = p + n;
+	suffixsort<T>::reset(text, len);
+
+	free_array(isa_assign);
+	free_array(patch);
+	isa_assign = patch = 0;
+	chunk = chunk_length(len);
+}
+
+template <typename T>
+size_t tupla::sortpar<T>::tqsort(size_t p, size_t n)
+{
+	size_t a,b,c,d;
+	size_t pn = p + n;
 
 	if (n < 7) return sort_small(p, n);
 
-	const uint64 v = choose_pivot(p, n);
+	const size_t v = choose_pivot(p, n);
 
 	// Partition
 	a = b = p;
@@ -35,8 +52,8 @@ uint32 tupla::sortpar::tqsort(uint32 p, size_t n)
 
 	// Assume on range i=f..g value ISA_h[ SA_h[i] ] is equal
 	// Only use the doubling part  ISA_h[ SA_h[i] + h ] in comparison
-	uint32 sv = (v & 0xFFFFFFFF);
-	uint32 tv;
+	size_t sv = v;
+	size_t tv;
 	for (;;) {
 		while (b <= c && (tv = isa[ sa[b] + h ]) <= sv) {
 			if (tv == sv) swap(a++, b); 
@@ -51,16 +68,16 @@ uint32 tupla::sortpar::tqsort(uint32 p, size_t n)
 	}
 
 	// Move split-end group to middle
-	const uint32 s = std::min(a-p, b-a ); vecswap(p, b-s, s);
-	const uint32 t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
+	const size_t s = std::min(a-p, b-a ); vecswap(p, b-s, s);
+	const size_t t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
 
-	const uint32 ltn = b-a;
-	const uint32 gtn = d-c;
-	const uint32 eqn = n - ltn - gtn;
+	const size_t ltn = b-a;
+	const size_t gtn = d-c;
+	const size_t eqn = n - ltn - gtn;
 
 	// New singleton groups in ranges less than and greater than pivot
-	uint32 lts = 0;
-	uint32 gts = 0;
+	size_t lts = 0;
+	size_t gts = 0;
 
 	if (ltn > 0) lts = sort_switch(p, ltn);
 	assign(p+ltn, eqn); 
@@ -69,14 +86,15 @@ uint32 tupla::sortpar::tqsort(uint32 p, size_t n)
 	return (lts + (eqn == 1) + gts);
 }
 
-uint32 tupla::sortpar::tqsort_grainsize(uint32 p, size_t n)
+template <typename T>
+size_t tupla::sortpar<T>::tqsort_grainsize(size_t p, size_t n)
 {
-	uint32 a,b,c,d;
-	uint32 pn = p + n;
+	size_t a,b,c,d;
+	size_t pn = p + n;
 
 	if (n < 7) return sort_small(p, n);
 
-	const uint64 v = choose_pivot(p, n);
+	const size_t v = choose_pivot(p, n);
 
 	// Partition
 	a = b = p;
@@ -84,8 +102,8 @@ uint32 tupla::sortpar::tqsort_grainsize(uint32 p, size_t n)
 
 	// Assume on range i=f..g value ISA_h[ SA_h[i] ] is equal
 	// Only use the doubling part  ISA_h[ SA_h[i] + h ] in comparison
-	uint32 sv = (v & 0xFFFFFFFF);
-	uint32 tv;
+	size_t sv = v;
+	size_t tv;
 	for (;;) {
 		while (b <= c && (tv = isa[ sa[b] + h ]) <= sv) {
 			if (tv == sv) swap(a++, b); 
@@ -100,16 +118,16 @@ uint32 tupla::sortpar::tqsort_grainsize(uint32 p, size_t n)
 	}
 
 	// Move split-end group to middle
-	const uint32 s = std::min(a-p, b-a ); vecswap(p, b-s, s);
-	const uint32 t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
+	const size_t s = std::min(a-p, b-a ); vecswap(p, b-s, s);
+	const size_t t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
 
-	const uint32 ltn = b-a;
-	const uint32 gtn = d-c;
-	const uint32 eqn = n - ltn - gtn;
+	const size_t ltn = b-a;
+	const size_t gtn = d-c;
+	const size_t eqn = n - ltn - gtn;
 
 	// New singleton groups in ranges less than and greater than pivot
-	uint32 lts = 0;
-	uint32 gts = 0;
+	size_t lts = 0;
+	size_t gts = 0;
 
 	if (ltn > 0) lts = tqsort_grainsize(p, ltn);
 	assign(p+ltn, eqn); 
@@ -118,41 +136,161 @@ uint32 tupla::sortpar::tqsort_grainsize(uint32 p, size_t n)
 	return (lts + (eqn == 1) + gts);
 }
 
-void tupla::sortpar::build_lcp()
+template <typename T>
+size_t tupla::sortpar<T>::radix_sort(size_t p, size_t n)
 {
-	if (!finished_sa) {
-		throw std::runtime_error("suffix array not complete");
+	const size_t buckets = ((size_t)1 << RadixBits);
+
+	// Range of doubling keys in group
+	size_t * lo = alloc_array<size_t>(jobs, std::string(),
+			work_flags(), opts.pool);
+	size_t * hi = alloc_array<size_t>(jobs, std::string(),
+			work_flags(), opts.pool);
+	std::fill(lo, lo+jobs, ~(size_t)0);
+	std::fill(hi, hi+jobs, 0);
+	parallel_range( boost::bind(&tupla::sortpar<T>::radix_bounds_range,
+			this, _1, _2, lo, hi, _3), p, n );
+	const size_t min = *std::min_element(lo, lo+jobs);
+	const size_t max = *std::max_element(hi, hi+jobs);
+	free_array(lo);
+	free_array(hi);
+
+	// Keys are equal
+	if (min == max) {
+		assign(p, n);
+		return (n == 1);
+	}
+
+	// Bucket number is the most significant bits of key offset
+	uint32 shift = 0;
+	while (((max - min) >> shift) >= buckets) ++shift;
+
+	size_t * range_count = alloc_array<size_t>(buckets * jobs, std::string(),
+			work_flags(), opts.pool);
+	memset(range_count, 0, (buckets * jobs * sizeof(size_t)) );
+	parallel_range( boost::bind(&tupla::sortpar<T>::radix_count_range,
+			this, _1, _2, min, shift, range_count, _3), p, n );
+
+	// Prefix sums for each thread in bucket order
+	size_t * bounds = alloc_array<size_t>(buckets + 1, std::string(),
+			work_flags(), opts.pool);
+	size_t f = 0;
+	for (size_t b = 0 ; b < buckets ; ++b) {
+		bounds[b] = f;
+		for (size_t j = 0 ; j < jobs ; ++j) {
+			size_t tn = range_count[(j * buckets) + b];
+			range_count[(j * buckets) + b] = f;
+			f += tn;
+		}
+	}
+	bounds[buckets] = n;
+
+	// Scatter to temporary array placed like the index arrays
+	T * out = alloc_array<T>(n, std::string(), alloc_flags(), opts.pool);
+	parallel_range( boost::bind(&tupla::sortpar<T>::radix_scatter_range,
+			this, _1, _2, min, shift, range_count, out, _3), p, n );
+	memcpy(sa + p, out, (n * sizeof(T)) );
+	free_array(out);
+	free_array(range_count);
+
+	// Split buckets to shares of about equal length for each thread
+	size_t * first = alloc_array<size_t>(jobs + 1, std::string(),
+			work_flags(), opts.pool);
+	size_t * ns = alloc_array<size_t>(jobs, std::string(),
+			work_flags(), opts.pool);
+	std::fill(ns, ns+jobs, 0);
+	first[0] = 0;
+	for (size_t j = 0 ; j < jobs ; ++j) {
+		size_t last = std::min(first[j] + 1, buckets);
+		while (last < buckets && bounds[last + 1] <= ((j + 1) * n) / jobs)
+			++last;
+		first[j + 1] = (j == jobs - 1 ? buckets : last);
 	}
+	sched.parallel_for( boost::bind(&tupla::sortpar<T>::radix_buckets,
+			this, p, bounds, first, ns, _3), 0, jobs, 1 );
+	free_array(first);
 
-	err << SELF << ": building longest common prefix array" << std::endl;
-	
-	lcp = new uint32[len];
-	memset(lcp, 0, (len * sizeof(uint32)) );
+	size_t total = 0;
+	for (size_t j = 0 ; j < jobs ; ++j)
+		total += ns[j];
 
-	parallel_chunk( boost::bind(&tupla::sortpar::lcp_range, this, _1, _2) );
-	
-	finished_lcp = true;
+	free_array(ns);
+	free_array(bounds);
+
+	return total;
+}
+
+template <typename T>
+void tupla::sortpar<T>::radix_bounds_range(size_t p, size_t n, size_t * lo,
+		size_t * hi, uint32 j)
+{
+	// Vectorized gather with 32-bit indices
+	if (std::is_same<T, uint32>::value) {
+		bounds_kernel((const uint32 *)isa + h, (const uint32 *)(sa + p), n,
+				&lo[j], &hi[j]);
+		return;
+	}
+
+	for (size_t i = p ; i < p+n ; ++i) {
+		const size_t k = isa[ sa[i] + h ];
+		if (k < lo[j]) lo[j] = k;
+		if (k > hi[j]) hi[j] = k;
+	}
 }
 
-uint32 tupla::sortpar::init()
+template <typename T>
+void tupla::sortpar<T>::radix_count_range(size_t p, size_t n, size_t min,
+		uint32 shift, size_t * range_count, uint32 j)
 {
-	uint32 group[Alpha] = { Z256 };
-	uint32 count[Alpha] = { Z256 };
+	size_t * task_count = (range_count + (j << RadixBits));
+	for (size_t i = p ; i < p+n ; ++i)
+		++task_count[ (isa[ sa[i] + h ] - min) >> shift ];
+}
+
+template <typename T>
+void tupla::sortpar<T>::radix_scatter_range(size_t p, size_t n, size_t min,
+		uint32 shift, size_t * range_count, T * out, uint32 j)
+{
+	size_t * task_count = (range_count + (j << RadixBits));
+	for (size_t i = p ; i < p+n ; ++i) {
+		const size_t v = sa[i];
+		out[ task_count[ (isa[ v + h ] - min) >> shift ]++ ] = v;
+	}
+}
+
+template <typename T>
+void tupla::sortpar<T>::radix_buckets(size_t p, const size_t * bounds,
+		const size_t * first, size_t * ns, uint32 j)
+{
+	for (size_t b = first[j] ; b < first[j + 1] ; ++b) {
+		const size_t bn = bounds[b + 1] - bounds[b];
+		if (bn > 0) ns[j] += sort_switch(p + bounds[b], bn);
+	}
+}
+
+template <typename T>
+uint32 tupla::sortpar<T>::init()
+{
+	size_t group[Alpha] = { Z256 };
+	size_t count[Alpha] = { Z256 };
 	uint8 sorted[Alpha] = { Z256 };
 
-	sa = new uint32[len];
-	isa = new uint32[len];
-	isa_assign = new uint32[len];
+	sa = alloc_array<T>(len, opts.sa_file, alloc_flags(), opts.pool);
+	isa = alloc_array<T>(len, std::string(), alloc_flags(), opts.pool);
+	isa_assign = alloc_array<T>(len, std::string(), alloc_flags(), opts.pool);
 
 	// Thread specific character counts
-	uint32 * range_count = new uint32[Alpha * jobs];
+	size_t * range_count = alloc_array<size_t>(Alpha * jobs, std::string(),
+			work_flags(), opts.pool);
 
-	memset(sa, 0, (len * sizeof(uint32)) );
-	memset(isa, 0, (len * sizeof(uint32)) );
-	memset(range_count, 0, (Alpha * jobs * sizeof(uint32)) );
+	memset(range_count, 0, (Alpha * jobs * sizeof(size_t)) );
+
+	// Zero arrays in the chunks of worker threads, placing pages on the
+	// memory nodes of the threads that process the chunks in later phases
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::zero_range, this, _1, _2) );
 
 	// Count characters and merge
-	parallel_chunk( boost::bind(&tupla::sortpar::count_range, 
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::count_range, 
 			this, _1, _2, range_count, _3) );
 	for (size_t i = 0 ; i < (jobs * Alpha) ; ++i)
 		count[i & 0xFF] += range_count[i];
@@ -165,21 +303,74 @@ uint32 tupla::sortpar::init()
 	uint32 alphasize = build_prefix(count, range_count, group, sorted, jobs);
 
 	// Counting sort on first character of suffix
-	parallel_chunk( boost::bind(&tupla::sortpar::sort_range, 
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::sort_range, 
 			this, _1, _2, range_count, group, sorted, _3) ); 
 
-	delete [] range_count;
+	free_array(range_count);
+
+	// Later rounds copy only new singleton groups
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::copy_range, this, _1, _2) );
+
+	// Lists hold n/16 entries in total, rounds with more copy whole array
+	patch_cap = std::min(len, std::max((size_t)PatchMinimum, len / (16 * jobs)));
+	patch = alloc_array<T>(patch_cap * jobs, std::string(),
+			alloc_flags(), opts.pool);
+
+	report_pages("assignment array", isa_assign);
 
 	return alphasize;
 }
 
-void tupla::sortpar::doubling_range(uint32 p, size_t n) {
-	uint32 sp = p; // Sorted group start
-	uint32 sl = 0; // Sorted groups length following start
-	uint32 ns = 0; // New singleton groups g
+template <typename T>
+void tupla::sortpar<T>::zero_range(size_t p, size_t n)
+{
+	// Output mapped to file is not zeroed, so its pages are written once
+	if (opts.sa_file.empty()) memset(sa + p, 0, (n * sizeof(T)) );
+	memset(isa + p, 0, (n * sizeof(T)) );
+}
+
+template <typename T>
+void tupla::sortpar<T>::copy_range(size_t p, size_t n)
+{
+	memcpy(isa_assign + p, isa + p, (n * sizeof(T)) );
+}
+
+template <typename T>
+void tupla::sortpar<T>::restored()
+{
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::copy_range, this, _1, _2) );
+}
+
+template <typename T>
+void tupla::sortpar<T>::patch_list(uint32 j)
+{
+	const T * list = patch + (j * patch_cap);
+	for (size_t i = 0 ; i < patch_len[j] ; ++i) {
+		const size_t s = list[i];
+		isa_assign[s] = isa[s];
+	}
+}
+
+template <typename T>
+void tupla::sortpar<T>::doubling_buckets(size_t t)
+{
+	std::vector<interval>& found = task_unsorted[t];
+	found.clear();
+
+	for (size_t k = task_first[t] ; k < task_first[t+1] ; ++k)
+		doubling_range(buckets[k].p, buckets[k].n, found);
+}
+
+template <typename T>
+void tupla::sortpar<T>::doubling_range(size_t p, size_t n,
+		std::vector<interval>& next)
+{
+	size_t sp = p; // Sorted group start
+	size_t sl = 0; // Sorted groups length following start
+	size_t ns = 0; // New singleton groups g
 	for (size_t i = p ; i < p+n ; ) {
 		// Skip sorted group
-		if (uint32 s = get_sorted(i)) {
+		if (size_t s = get_sorted(i)) {
 			i += s; sl += s;
 			continue;
 		} 
@@ -189,52 +380,86 @@ void tupla::sortpar::doubling_range(uint32 p, size_t n) {
 			sl = 0;
 		}
 		// Sort unsorted group i..g
-		uint32 g = isa[ sa[i] ] + 1;
+		size_t g = isa[ sa[i] ] + 1;
 
-		ns += sort_switch(i, g-i);
+		// Groups sorted in new tasks are counted as unsorted
+		size_t gs = sort_switch(i, g-i);
+		if (gs < g-i) add_unsorted(next, i, g-i);
+		ns += gs;
 
 		sp = i = g;
 	}
 	// Combine sorted group at end
 	if (sl > 0) set_sorted(sp, sl);
 
-	groups_lock.lock();
-	groups += ns;
-	groups_lock.unlock();
+	__atomic_fetch_add(&groups, ns, __ATOMIC_RELAXED);
 }
 
-void tupla::sortpar::invert()
+template <typename T>
+void tupla::sortpar<T>::invert()
 {
-	parallel_chunk( boost::bind(&tupla::sortpar::invert_range, this, _1, _2) ); 
+	parallel_chunk( boost::bind(&tupla::sortpar<T>::invert_range, this, _1, _2) ); 
 }
 
-void tupla::sortpar::doubling()
+template <typename T>
+void tupla::sortpar<T>::doubling()
 {
-	memcpy(isa_assign, isa, sizeof(uint32) * len);
-
-	// Thread pool
-	tp.size_controller().resize(jobs);
+	std::fill(patch_len, patch_len + jobs, 0);
+	patch_overflow = false;
 
 	// TODO Do not spawn if ((len - groups) < BucketSize) to limit overhead 
 
-	// Buckets p..pn
-	for (uint32 p = 0, pn = BucketSize ; p < len ; p = pn , pn += BucketSize) {
-		if (pn > len - h) pn = len; // End of file
-		else if (!get_sorted(pn)) pn = isa[ sa[pn] ] + 1; // Last in group
-
-		boost::shared_ptr<doubling_task> job(
-				new doubling_task(this, p, (pn-p)));
-		boost::threadpool::schedule(tp, 
-				boost::bind(&doubling_task::run, job));
+	// Buckets p..pn in each unsorted interval
+	buckets.clear();
+	for (size_t r = 0 ; r < unsorted.size() ; ++r) {
+		const size_t e = unsorted[r].p + unsorted[r].n;
+		for (size_t p = unsorted[r].p, pn = p + BucketSize ; p < e ; 
+				p = pn , pn += BucketSize) {
+			if (pn >= e) pn = e; // End of interval
+			else if (!get_sorted(pn)) pn = isa[ sa[pn] ] + 1; // Last in group
 
+			buckets.push_back( interval{ p, (pn-p) } );
+		}
 	}
-	tp.wait();
 
-	// Keep count of assigned singletons
-	for (auto it : tasks) groups += it.groups;
-	tasks.clear();
+	// Tasks run consecutive buckets totaling at least BucketSize suffixes
+	task_first.clear();
+	for (size_t k = 0 ; k < buckets.size() ; ) {
+		task_first.push_back(k);
+		for (size_t m = 0 ; k < buckets.size() && m < BucketSize ; ++k)
+			m += buckets[k].n;
+	}
+	const size_t tasks = task_first.size();
+	task_first.push_back(buckets.size());
+	task_unsorted.resize(tasks);
+
+	for (size_t t = 0 ; t < tasks ; ++t)
+		sched.schedule(&sortpar::doubling_task, this, t, 0);
+	sched.wait();
+
+	// Join groups found by tasks to intervals in suffix array order
+	std::vector<interval> next;
+	for (size_t t = 0 ; t < tasks ; ++t) {
+		for (size_t i = 0 ; i < task_unsorted[t].size() ; ++i)
+			add_unsorted(next, task_unsorted[t][i].p, task_unsorted[t][i].n);
+	}
+	unsorted.swap(next);
 
 	std::swap( isa, isa_assign );
+
+	// Bring assignment array up to date for next round
+	if (patch_overflow) {
+		parallel_chunk( boost::bind(&tupla::sortpar<T>::copy_range,
+				this, _1, _2) );
+	}
+	else {
+		sched.parallel_for( boost::bind(&tupla::sortpar<T>::patch_list,
+				this, _3), 0, jobs, 1 );
+	}
 }
 
+template class tupla::sortpar<uint32>;
+template class tupla::sortpar<uint64>;
+template class tupla::sortpar<uint40>;
+
 // vim:set ts=4 sts=4 sw=4 noexpandtab:
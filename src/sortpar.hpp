@@ -1,89 +1,193 @@
 /**
- * Doubling suffix sort. Parallel implementation. Requires 12n memory.
+ * Doubling suffix sort. Parallel implementation. Requires 12n memory
+ * with 32-bit indices, 15n with packed 40-bit indices, and n/16 entries
+ * listing new singleton groups, at least PatchMinimum for each job.
+ * Groups of at least RadixSize suffixes are scattered through temporary
+ * arrays of their length, up to n more indices.
+ *
+ * LCP array is built from irreducible values of permuted LCP array,
+ * computed and filled in parallel, reusing the suffix sorting arrays.
  *
  * @author jkataja
  */
 
 #pragma once
 
-#include <boost/thread/mutex.hpp>
-#include <boost/threadpool.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 #include "numdefs.hpp"
 #include "suffixsort.hpp"
-#include "tqsort_task.hpp"
+#include "scheduler.hpp"
 
 namespace tupla {
 
-class sortpar : public suffixsort {
+template <typename T = uint32>
+class sortpar : public suffixsort<T> {
 
 private:
 
+	using suffixsort<T>::sa;
+	using suffixsort<T>::isa;
+	using suffixsort<T>::lcp;
+	using suffixsort<T>::h;
+	using suffixsort<T>::len;
+	using suffixsort<T>::groups;
+	using suffixsort<T>::err;
+	using suffixsort<T>::finished_sa;
+	using suffixsort<T>::finished_lcp;
+	using suffixsort<T>::count_range;
+	using suffixsort<T>::build_prefix;
+	using suffixsort<T>::sort_range;
+	using suffixsort<T>::invert_range;
+	using suffixsort<T>::irreducible_range;
+	using suffixsort<T>::fill_plcp_range;
+	using suffixsort<T>::plcp_carries;
+	using suffixsort<T>::carry_plcp_range;
+	using suffixsort<T>::permute_lcp_range;
+	using suffixsort<T>::choose_pivot;
+	using suffixsort<T>::swap;
+	using suffixsort<T>::vecswap;
+	using suffixsort<T>::get_sorted;
+	using suffixsort<T>::set_sorted;
+	using suffixsort<T>::opts;
+	using suffixsort<T>::alloc_flags;
+	using suffixsort<T>::work_flags;
+	using suffixsort<T>::report_pages;
+	using suffixsort<T>::kvsort;
+	using suffixsort<T>::unsorted;
+	using suffixsort<T>::add_unsorted;
+
+	typedef typename suffixsort<T>::interval interval;
+
 	sortpar(const sortpar&);
 	sortpar& operator=(const sortpar&);
 
-	boost::mutex tasks_lock;
-	boost::mutex groups_lock;
-
-	// Pooled sort operations
-	boost::threadpool::pool tp;
-
 	// Concurrent modifications to isa would alter sorting order
 	// Assign new groups after doubling to this array temporarily
-	uint32 * isa_assign; 
+	// Arrays are swapped after each round. Unsorted groups are renumbered
+	// every round, so only new singleton groups are copied back to keep
+	// the arrays equal
+	T * isa_assign; 
+
+	// Suffixes of new singleton groups in round, listed for each worker
+	T * patch;
+	size_t * patch_len;
+	size_t patch_cap;
+
+	// Some list was full, copy whole array instead
+	bool patch_overflow;
 
 	// Number of concurrent threads to run
 	const uint32 jobs;
 
 	// Share of text length per job
-	const size_t chunk;
+	size_t chunk;
+
+	// Share of text length per job for input length
+	inline size_t chunk_length(const size_t n) const
+	{
+		return std::min( std::max((size_t)BucketSize, (n/jobs) + 1), n );
+	}
+
+	// Work-stealing scheduler for all parallel phases
+	scheduler sched;
+
+	// Unsorted intervals split to buckets ending at group boundaries
+	std::vector<interval> buckets;
+
+	// First bucket of each doubling task, task t runs buckets up to the
+	// first of task t+1
+	std::vector<size_t> task_first;
+
+	// Groups which may remain unsorted found by each doubling task
+	std::vector< std::vector<interval> > task_unsorted;
+
+	// Zero range of isa, and of sa unless it is mapped to output file
+	void zero_range(size_t, size_t);
+
+	// Copy range of isa to isa_assign
+	void copy_range(size_t, size_t);
+
+	// Copy new singleton groups listed by worker j to isa_assign
+	void patch_list(uint32);
+
+	// Task running doubling step on buckets of task t
+	static void doubling_task(void * obj, size_t t, size_t)
+	{
+		((sortpar *)obj)->doubling_buckets(t);
+	}
+
+	// Doubling step on buckets of task t
+	void doubling_buckets(size_t);
+
+	// Task sorting range, counting its new singleton groups
+	static void tqsort_task(void * obj, size_t p, size_t n)
+	{
+		sortpar * sorter = (sortpar *)obj;
+		__atomic_fetch_add(&sorter->groups, sorter->tqsort(p, n),
+				__ATOMIC_RELAXED);
+	}
 
-	// Invoke function parallel for each thread's range in input
+	// Invoke function parallel for each thread's range in input, range j
+	// always runs on worker j
 	template <class F>
 	void parallel_chunk(F fun_range)
 	{
-		boost::thread_group threads;
-		size_t p = 0;
-		size_t n = len;
-
-		for (size_t j = 0 ; j < jobs ; ++j) {
-			threads.create_thread( 
-					boost::bind(fun_range, p, std::min(n, chunk), j) );
+		sched.parallel_for(fun_range, 0, len, chunk, true);
+	}
 
-			if (n <= chunk) break;
-			n -= chunk; p += chunk;
-		}
-		threads.join_all();
+	// Invoke function parallel for each thread's share of range p..p+n-1
+	template <class F>
+	void parallel_range(F fun_range, size_t p, size_t n)
+	{
+		sched.parallel_for(fun_range, p, n, (n + jobs - 1) / jobs);
 	}
 
+	// Sort huge range p..p+n-1 with parallel radix pass on most significant
+	// bits of doubling keys, then sort the radix buckets in parallel
+	// Scatters through a temporary array of n indices
+	// Returns the count of new singleton groups
+	size_t radix_sort(size_t p, size_t n);
+
+	// Smallest and largest doubling key in range
+	void radix_bounds_range(size_t, size_t, size_t *, size_t *, uint32);
+
+	// Count doubling keys in range for each radix bucket
+	void radix_count_range(size_t, size_t, size_t, uint32, size_t *, uint32);
+
+	// Move suffixes in range to thread's offsets in radix buckets
+	void radix_scatter_range(size_t, size_t, size_t, uint32, size_t *, T *,
+			uint32);
+
+	// Sort radix buckets in share j of range starting at p
+	void radix_buckets(size_t, const size_t *, const size_t *, size_t *,
+			uint32);
+
 	// Ternary quicksort on items in range p..p+n-1
 	// Recurse to sort_switch
 	// Returns the count of new singleton groups
-	uint32 tqsort(uint32 p, size_t n);
+	size_t tqsort(size_t p, size_t n);
 
 	// Ternary quicksort on items in range p..p+n-1
 	// Recurse to tqsort_grainsize
 	// Returns the count of new singleton groups
-	uint32 tqsort_grainsize(uint32 p, size_t n);
-
-	// Pointers to sort tasks added too task pool
-	boost::ptr_vector<tqsort_task> tasks;
+	size_t tqsort_grainsize(size_t p, size_t n);
 
 	// Sort small range using variation of selection sort
 	// Based on N. Jesper Larsson & Kunihiko Sadakane: Faster Suffix Sorting
-	inline uint32 sort_small(uint32 p, uint32 n)
+	inline size_t sort_small(size_t p, size_t n)
 	__attribute__((always_inline))
 	{
-		uint32 a = p; // Start of current sorting range and minimum group
-		uint32 b = p; // End of minimum group
-		uint32 d = p+n-1; // End of sorting range
-		uint32 ns = 0; // Count of assigned singleton groups
-		uint32 tv; // Comparison element
+		size_t a = p; // Start of current sorting range and minimum group
+		size_t b = p; // End of minimum group
+		size_t d = p+n-1; // End of sorting range
+		size_t ns = 0; // Count of assigned singleton groups
+		size_t tv; // Comparison element
 
 		while (a < d) {
 			// Move minimum group to range a..b-1
-			for (uint32 i = b = a+1 , min = isa[ sa[a] + h ] ; i <= d ; ++i) {
+			for (size_t i = b = a+1 , min = isa[ sa[a] + h ] ; i <= d ; ++i) {
 				if ((tv = isa[ sa[i] + h ]) < min) {
 					min = tv;
 					swap(i, a);
@@ -109,35 +213,53 @@ private:
 
 	// Sort grain size range in this thread, or add new task to sort it later
 	// Returns the count of new singleton groups
-	inline uint32 sort_switch(uint32 p, size_t n) 
+	inline size_t sort_switch(size_t p, size_t n) 
 	{
+		// Sort huge range with all threads
+		if (n >= RadixSize) return radix_sort(p, n);
+
 		// Call tqsort in this thread
-		if (n < BucketSize) return tqsort_grainsize(p, n);
+		if (n < BucketSize) {
+			if (opts.gather && n >= 7) {
+				return kvsort(p, n,
+						[this](size_t f, size_t m) { assign(f, m); });
+			}
+			return tqsort_grainsize(p, n);
+		}
 
-		// Create new task in thread pool to sort range
-		tqsort_task * job = new tqsort_task(this, p, n);
-		boost::threadpool::schedule(tp, boost::bind(&tqsort_task::run, job));
-	
-		tasks_lock.lock();
-		tasks.push_back(job);
-		tasks_lock.unlock();
+		// Create new task to sort range
+		sched.schedule(&sortpar::tqsort_task, this, p, n);
 
-		return 0; // Added in doubling()
+		return 0; // Added when task finishes
 	}
 
 	// Renumber group at p..p+n-1 with matching sorting key as p+n-1
 	// Group number is last index with value to keep sort keys decreasing
 	// Store assignments in isa_assign due to concurrent modifications 
 	// altering sort ordering
-	inline void assign(uint32 p, size_t n)
+	inline void assign(size_t p, size_t n)
 	__attribute__((always_inline))
 	{
-		uint32 g = p + n - 1;
+		size_t g = p + n - 1;
 
 		for (size_t i = p ; i < p+n ; ++i) 
 			isa_assign[ sa[i] ] = g;
 		
-		if (n == 1) set_sorted(p, 1); // Mark as sorted singleton group
+		if (n == 1) {
+			patch_add(sa[p]);
+			set_sorted(p, 1); // Mark as sorted singleton group
+		}
+	}
+
+	// List suffix of new singleton group to copy after round
+	inline void patch_add(size_t s)
+	{
+		const uint32 j = sched.worker();
+		if (j >= jobs || patch_len[j] == patch_cap) {
+			__atomic_store_n(&patch_overflow, true, __ATOMIC_RELAXED);
+			return;
+		}
+		patch[ (j * patch_cap) + patch_len[j]++ ] = s;
 	}
 
 protected:
@@ -145,13 +267,21 @@ protected:
 
 	virtual void invert();
 	virtual void doubling();
-	virtual void doubling_range(uint32, size_t);
+	virtual void doubling_range(size_t, size_t, std::vector<interval>&);
+	virtual void restored();
+	virtual size_t tasks_scheduled() { return sched.tasks(); }
+	virtual size_t lcp_chunk() { return chunk; }
+	virtual void run_chunks(const typename suffixsort<T>::range_fun& fun)
+	{
+		parallel_chunk(fun);
+	}
 
 public:
 
-	sortpar(const char *, const uint32, const uint32, std::ostream&);
+	sortpar(const char *, const size_t, const uint32, std::ostream&,
+			const sortopts&);
 	virtual ~sortpar();
-	virtual void build_lcp();
+	virtual void reset(const char *, const size_t);
 
 };
 
@@ -0,0 +1,271 @@
+#include "sortsais.hpp"
+#include "tupla.hpp"
+#include "stats.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+using namespace tupla;
+
+template <typename T>
+const uint64 tupla::sortsais<T>::Empty;
+
+template <typename T>
+tupla::sortsais<T>::sortsais(const char * text, const size_t len,
+		std::ostream& err, const sortopts& opts)
+	: suffixsort<T>(text, len, err, opts)
+{
+}
+
+template <typename T>
+tupla::sortsais<T>::~sortsais()
+{
+}
+
+template <typename T>
+void tupla::sortsais<T>::build_sa()
+{
+	if (finished_sa) return;
+
+	stats_clock start;
+	uint32 alphasize = init();
+	err << SELF << ": alphabet size " << alphasize << std::endl;
+	if (opts.stats) opts.stats->add_phase("init", start);
+
+	stats_clock induce_start;
+	sais((const uint8 *)text, sa, len, Alpha, 0);
+	groups = len;
+	if (opts.stats) opts.stats->add_phase("induce", induce_start);
+
+	finished_sa = true;
+}
+
+template <typename T>
+uint32 tupla::sortsais<T>::init()
+{
+	memset(count, 0, (Alpha * sizeof(size_t)) );
+
+	sa = alloc_array<T>(len, opts.sa_file, alloc_flags(), opts.pool);
+
+	// Count character occurences, unless counted while reading
+	if (opts.text_count) memcpy(count, opts.text_count, (Alpha * sizeof(size_t)));
+	else count_range(0, len, count, 0);
+
+	// Multiple nulls in input
+	if (count[0] != 1)
+		throw std::runtime_error("input contains multiple nulls");
+
+	uint32 alphasize = 0;
+	for (size_t i = 0 ; i < Alpha ; ++i)
+		alphasize += (count[i] > 0);
+
+	return alphasize;
+}
+
+template <typename T>
+void tupla::sortsais<T>::invert()
+{
+}
+
+template <typename T>
+void tupla::sortsais<T>::doubling()
+{
+}
+
+template <typename T>
+void tupla::sortsais<T>::doubling_range(size_t p, size_t n,
+		std::vector<typename suffixsort<T>::interval>& next)
+{
+}
+
+template <typename T>
+void tupla::sortsais<T>::classify(const uint8 * s, uint8 * t, size_t n)
+{
+	classify<uint8>(s, t, n);
+}
+
+template <typename T>
+void tupla::sortsais<T>::get_buckets(const uint8 * s, T * bkt, size_t n,
+		size_t k, bool end)
+{
+	// Input text counts are known from init
+	size_t sum = 0;
+	for (size_t i = 0 ; i < k ; ++i) {
+		sum += count[i];
+		bkt[i] = (end ? sum : sum - count[i]);
+	}
+}
+
+template <typename T>
+void tupla::sortsais<T>::place_lms(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	place_lms<uint8>(s, t, sa, bkt, n, k);
+}
+
+template <typename T>
+void tupla::sortsais<T>::induce_l(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	induce_l<uint8>(s, t, sa, bkt, n, k);
+}
+
+template <typename T>
+void tupla::sortsais<T>::induce_s(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	induce_s<uint8>(s, t, sa, bkt, n, k);
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::classify(const C * s, uint8 * t, size_t n)
+{
+	// Terminator is S-type, each suffix before it compares to the next
+	set_stype(t, n-1, true);
+	for (size_t i = n-1 ; i-- > 0 ; )
+		set_stype(t, i, (s[i] < s[i+1]
+				|| (s[i] == s[i+1] && stype(t, i+1))) );
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::get_buckets(const C * s, T * bkt, size_t n,
+		size_t k, bool end)
+{
+	memset(bkt, 0, (k * sizeof(T)) );
+	for (size_t i = 0 ; i < n ; ++i)
+		++bkt[ s[i] ];
+
+	size_t sum = 0;
+	for (size_t i = 0 ; i < k ; ++i) {
+		sum += bkt[i];
+		bkt[i] = (end ? sum : sum - bkt[i]);
+	}
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::place_lms(const C * s, const uint8 * t, T * sa,
+		T * bkt, size_t n, size_t k)
+{
+	get_buckets(s, bkt, n, k, true);
+	std::fill(sa, sa+n, Empty);
+	for (size_t i = 1 ; i < n ; ++i)
+		if (is_lms(t, i)) sa[ --bkt[ s[i] ] ] = i;
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::induce_l(const C * s, const uint8 * t, T * sa,
+		T * bkt, size_t n, size_t k)
+{
+	get_buckets(s, bkt, n, k, false);
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t j = sa[i];
+		if (j != Empty && j > 0 && !stype(t, j-1))
+			sa[ bkt[ s[j-1] ]++ ] = j-1;
+	}
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::induce_s(const C * s, const uint8 * t, T * sa,
+		T * bkt, size_t n, size_t k)
+{
+	get_buckets(s, bkt, n, k, true);
+	for (size_t i = n ; i-- > 0 ; ) {
+		size_t j = sa[i];
+		if (j != Empty && j > 0 && stype(t, j-1))
+			sa[ --bkt[ s[j-1] ] ] = j-1;
+	}
+}
+
+template <typename T>
+template <typename C>
+void tupla::sortsais<T>::sais(const C * s, T * sa, size_t n, size_t k,
+		uint32 depth)
+{
+	// Terminator only
+	if (n == 1) {
+		sa[0] = 0;
+		return;
+	}
+
+	uint8 * t = alloc_array<uint8>((n >> 3) + 1, std::string(),
+			work_flags(), opts.pool);
+	T * bkt = alloc_array<T>(k, std::string(), work_flags(), opts.pool);
+
+	classify(s, t, n);
+
+	// Place LMS suffixes to ends of buckets and induce LMS substring order
+	place_lms(s, t, sa, bkt, n, k);
+	induce_l(s, t, sa, bkt, n, k);
+	induce_s(s, t, sa, bkt, n, k);
+
+	// Compact sorted LMS substrings to first n1 items
+	size_t n1 = 0;
+	for (size_t i = 0 ; i < n ; ++i)
+		if (is_lms(t, sa[i])) sa[n1++] = sa[i];
+
+	// Name LMS substrings, LMS positions are at least two apart so
+	// name for position p fits at n1 + p/2
+	std::fill(sa+n1, sa+n, Empty);
+	size_t name = 0;
+	size_t prev = Empty;
+	for (size_t i = 0 ; i < n1 ; ++i) {
+		size_t p = sa[i];
+		bool diff = (prev == Empty);
+		for (size_t d = 0 ; !diff ; ++d) {
+			if (s[p+d] != s[prev+d] || stype(t, p+d) != stype(t, prev+d))
+				diff = true;
+			else if (d > 0 && (is_lms(t, p+d) || is_lms(t, prev+d)))
+				break;
+		}
+		if (diff) { ++name; prev = p; }
+		sa[n1 + (p >> 1)] = name - 1;
+	}
+	for (size_t i = n, j = n ; i-- > n1 ; )
+		if (sa[i] != Empty) sa[--j] = sa[i];
+
+	err << SELF << ": induced sorting level " << depth << " with "
+			<< n1 << " LMS substrings and " << name << " names" << std::endl;
+
+	// Buckets are released during recursion, so only buckets of one
+	// reduced problem are allocated at a time
+	free_array(bkt);
+
+	// Sort reduced problem recursively unless names are unique
+	T * sa1 = sa;
+	T * s1 = sa + n - n1;
+	if (name < n1) sais(s1, sa1, n1, name, depth+1);
+	else for (size_t i = 0 ; i < n1 ; ++i) sa1[ s1[i] ] = i;
+
+	// Map reduced suffix order back to LMS suffixes of s
+	for (size_t i = 1, j = 0 ; i < n ; ++i)
+		if (is_lms(t, i)) s1[j++] = i;
+	for (size_t i = 0 ; i < n1 ; ++i)
+		sa1[i] = s1[ sa1[i] ];
+	std::fill(sa+n1, sa+n, Empty);
+
+	// Place sorted LMS suffixes to ends of buckets and induce
+	bkt = alloc_array<T>(k, std::string(), work_flags(), opts.pool);
+	get_buckets(s, bkt, n, k, true);
+	for (size_t i = n1 ; i-- > 0 ; ) {
+		size_t j = sa[i];
+		sa[i] = Empty;
+		sa[ --bkt[ s[j] ] ] = j;
+	}
+	induce_l(s, t, sa, bkt, n, k);
+	induce_s(s, t, sa, bkt, n, k);
+
+	free_array(bkt);
+	free_array(t);
+}
+
+template class tupla::sortsais<uint32>;
+template class tupla::sortsais<uint64>;
+template class tupla::sortsais<uint40>;
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,126 @@
+/**
+ * Induced suffix sort. Sequential implementation requires 5n memory
+ * with 32-bit indices, plus buckets for the reduced problems.
+ *
+ * Implements SA-IS as described in:
+ * G. Nong, S. Zhang & W. H. Chan 2009: Linear Suffix Array Construction
+ * by Almost Pure Induced-Sorting. DCC 2009, 193-202
+ *
+ * Reduced alphabet has up to n/2 names, so its buckets take up to
+ * n/2 indices (2n bytes with 32-bit indices) more memory, usually much
+ * less. Buckets of one level are allocated at a time.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <iostream>
+#include <boost/cstdint.hpp>
+
+#include "numdefs.hpp"
+#include "suffixsort.hpp"
+
+namespace tupla {
+
+template <typename T = uint32>
+class sortsais : public suffixsort<T> {
+private:
+	sortsais(const sortsais&);
+	sortsais& operator=(const sortsais&);
+
+protected:
+	using suffixsort<T>::sa;
+	using suffixsort<T>::text;
+	using suffixsort<T>::len;
+	using suffixsort<T>::opts;
+	using suffixsort<T>::alloc_flags;
+	using suffixsort<T>::work_flags;
+	using suffixsort<T>::report_pages;
+	using suffixsort<T>::groups;
+	using suffixsort<T>::err;
+	using suffixsort<T>::finished_sa;
+	using suffixsort<T>::count_range;
+
+	// Marks empty slot in suffix array during induced sorting
+	static const uint64 Empty = index_traits<T>::Max;
+
+	// Type of suffix i is S (1) or L (0)
+	inline bool stype(const uint8 * t, const size_t i) const
+	__attribute__((always_inline))
+	{
+		return (t[i >> 3] >> (i & 7)) & 1;
+	}
+
+	inline void set_stype(uint8 * t, const size_t i, const bool s)
+	__attribute__((always_inline))
+	{
+		if (s) t[i >> 3] |= (1 << (i & 7));
+		else t[i >> 3] &= ~(1 << (i & 7));
+	}
+
+	// Suffix i is leftmost S-type suffix
+	inline bool is_lms(const uint8 * t, const size_t i) const
+	__attribute__((always_inline))
+	{
+		return (i > 0 && i != Empty && stype(t, i) && !stype(t, i-1));
+	}
+
+	// Character counts of input text
+	size_t count[Alpha];
+
+	// Classify suffixes of s as S or L type
+	template <typename C>
+	void classify(const C *, uint8 *, size_t);
+
+	// Bucket starts (or ends) of alphabet k in s
+	template <typename C>
+	void get_buckets(const C *, T *, size_t, size_t, bool);
+
+	// Place LMS suffixes to ends of buckets, other slots empty
+	template <typename C>
+	void place_lms(const C *, const uint8 *, T *, T *, size_t,
+			size_t);
+
+	// Induce L-type suffixes scanning left to right
+	template <typename C>
+	void induce_l(const C *, const uint8 *, T *, T *, size_t,
+			size_t);
+
+	// Induce S-type suffixes scanning right to left
+	template <typename C>
+	void induce_s(const C *, const uint8 *, T *, T *, size_t,
+			size_t);
+
+	// Steps on input text, reduced problems use the templates above
+	virtual void classify(const uint8 *, uint8 *, size_t);
+	virtual void get_buckets(const uint8 *, T *, size_t, size_t, bool);
+	virtual void place_lms(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+	virtual void induce_l(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+	virtual void induce_s(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+
+	// Sort suffixes of s with alphabet k, recursing on reduced problem
+	template <typename C>
+	void sais(const C *, T *, size_t, size_t, uint32);
+
+	virtual uint32 init();
+	virtual void invert();
+
+	// Induced sorting has no doubling steps
+	virtual void doubling();
+	virtual void doubling_range(size_t, size_t,
+			std::vector<typename suffixsort<T>::interval>&);
+
+public:
+	sortsais(const char *, const size_t, std::ostream&, const sortopts&);
+	virtual ~sortsais();
+	virtual void build_sa();
+
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,271 @@
+#include "sortsaispar.hpp"
+#include "tupla.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+using namespace tupla;
+
+template <typename T>
+const uint16 tupla::sortsaispar<T>::NoInduce;
+
+template <typename T>
+tupla::sortsaispar<T>::sortsaispar(const char * text, const size_t len,
+		const uint32 jobs, std::ostream& err, const sortopts& opts)
+	: sortsais<T>(text, len, err, opts), jobs(jobs),
+	  chunk( chunk_length(len) ),
+	  scan_text(0), scan_types(0), scan_sa(0), scan_n(0), scan_blocks(0),
+	  scan_left(true), scan_sync(0), sched(jobs, opts.pin)
+{
+	for (size_t i = 0 ; i < 2 ; ++i) {
+		seen[i] = new T[BucketSize];
+		code[i] = new uint16[BucketSize];
+	}
+}
+
+template <typename T>
+tupla::sortsaispar<T>::~sortsaispar()
+{
+	for (size_t i = 0 ; i < 2 ; ++i) {
+		delete [] seen[i];
+		delete [] code[i];
+	}
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::reset(const char * text, const size_t len)
+{
+	suffixsort<T>::reset(text, len);
+
+	chunk = chunk_length(len);
+}
+
+template <typename T>
+uint32 tupla::sortsaispar<T>::init()
+{
+	memset(count, 0, (Alpha * sizeof(size_t)) );
+
+	sa = alloc_array<T>(len, opts.sa_file, alloc_flags(), opts.pool);
+
+	// Count characters and merge, unless counted while reading
+	if (opts.text_count) {
+		memcpy(count, opts.text_count, (Alpha * sizeof(size_t)));
+	}
+	else {
+		size_t * range_count = alloc_array<size_t>(Alpha * jobs,
+				std::string(), work_flags(), opts.pool);
+		memset(range_count, 0, (Alpha * jobs * sizeof(size_t)) );
+		parallel_chunk( boost::bind(&tupla::sortsaispar<T>::count_range,
+				this, _1, _2, range_count, _3) );
+		for (size_t i = 0 ; i < (jobs * Alpha) ; ++i)
+			count[i & 0xFF] += range_count[i];
+		free_array(range_count);
+	}
+
+	// Multiple nulls in input
+	if (count[0] != 1)
+		throw std::runtime_error("input contains multiple nulls");
+
+	uint32 alphasize = 0;
+	for (size_t i = 0 ; i < Alpha ; ++i)
+		alphasize += (count[i] > 0);
+
+	return alphasize;
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::classify(const uint8 * s, uint8 * t, size_t n)
+{
+	parallel_chunk( boost::bind(&tupla::sortsaispar<T>::classify_range,
+			this, s, t, _1, _2) );
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::classify_range(const uint8 * s, uint8 * t,
+		size_t p, size_t n)
+{
+	// Type of last suffix in range is decided by next different character
+	size_t e = p + n - 1;
+	bool st = true;
+	if (e < len - 1) {
+		size_t q = e + 1;
+		while (s[q] == s[e]) ++q;
+		st = (s[e] < s[q]);
+	}
+	set_stype(t, e, st);
+
+	for (size_t i = e ; i-- > p ; )
+		set_stype(t, i, (s[i] < s[i+1]
+				|| (s[i] == s[i+1] && stype(t, i+1))) );
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::empty_range(T * sa, size_t p, size_t n)
+{
+	std::fill(sa+p, sa+p+n, Empty);
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::count_lms_range(const uint8 * s, const uint8 * t,
+		size_t * lms_count, size_t p, size_t n, uint32 j)
+{
+	size_t * task_count = (lms_count + (j * Alpha));
+	for (size_t i = p ; i < p+n ; ++i)
+		if (is_lms(t, i)) ++task_count[ s[i] ];
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::place_lms_range(const uint8 * s, const uint8 * t,
+		T * sa, size_t * lms_count, size_t p, size_t n, uint32 j)
+{
+	size_t * task_count = (lms_count + (j * Alpha));
+	for (size_t i = p ; i < p+n ; ++i)
+		if (is_lms(t, i)) sa[ --task_count[ s[i] ] ] = i;
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::place_lms(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	size_t * lms_count = alloc_array<size_t>(Alpha * jobs, std::string(),
+			work_flags(), opts.pool);
+	memset(lms_count, 0, (Alpha * jobs * sizeof(size_t)) );
+
+	parallel_chunk( boost::bind(&tupla::sortsaispar<T>::empty_range,
+			this, sa, _1, _2) );
+	parallel_chunk( boost::bind(&tupla::sortsaispar<T>::count_lms_range,
+			this, s, t, lms_count, _1, _2, _3) );
+
+	// Offsets for each thread from end of bucket
+	get_buckets(s, bkt, n, k, true);
+	for (size_t c = 0 ; c < Alpha ; ++c) {
+		size_t e = bkt[c];
+		for (size_t j = 0 ; j < jobs ; ++j) {
+			size_t tn = lms_count[(j * Alpha) + c];
+			lms_count[(j * Alpha) + c] = e;
+			e -= tn;
+		}
+	}
+
+	parallel_chunk( boost::bind(&tupla::sortsaispar<T>::place_lms_range,
+			this, s, t, sa, lms_count, _1, _2, _3) );
+
+	free_array(lms_count);
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::induce_l(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	get_buckets(s, bkt, n, k, false);
+	induce(s, t, sa, bkt, n, k, true);
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::induce_s(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k)
+{
+	get_buckets(s, bkt, n, k, true);
+	induce(s, t, sa, bkt, n, k, false);
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::induce(const uint8 * s, const uint8 * t,
+		T * sa, T * bkt, size_t n, size_t k, bool left)
+{
+	boost::barrier sync(jobs);
+
+	scan_text = s;
+	scan_types = t;
+	scan_sa = sa;
+	scan_n = n;
+	scan_blocks = (n + BucketSize - 1) / BucketSize;
+	scan_left = left;
+	scan_sync = &sync;
+
+	// Each worker takes one scan task and waits on barrier
+	for (size_t j = 1 ; j < jobs ; ++j)
+		sched.schedule(&sortsaispar::scan_task, this, j, 0);
+
+	// First block is prepared by all threads
+	prepare_block(0, 0, jobs);
+	sync.wait();
+
+	for (size_t b = 0 ; b < scan_blocks ; ++b) {
+		commit_block(b, bkt);
+		sync.wait();
+	}
+
+	sched.wait();
+	scan_sync = 0;
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::scan_worker(uint32 j)
+{
+	prepare_block(0, j, jobs);
+	scan_sync->wait();
+
+	for (size_t b = 0 ; b < scan_blocks ; ++b) {
+		if (b + 1 < scan_blocks) prepare_block(b + 1, j - 1, jobs - 1);
+		scan_sync->wait();
+	}
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::prepare_block(size_t b, uint32 part,
+		uint32 parts)
+{
+	size_t p, n;
+	block_range(b, p, n);
+
+	T * block_seen = seen[b & 1];
+	uint16 * block_code = code[b & 1];
+
+	// Share of block for this thread
+	size_t share = (n + parts - 1) / parts;
+	size_t f = std::min(n, part * share);
+	size_t g = std::min(n, f + share);
+
+	// Committing thread may be writing to this block
+	for (size_t i = f ; i < g ; ++i) {
+		size_t j = index_load(scan_sa + p + i);
+		block_seen[i] = j;
+		block_code[i] = induced(j);
+	}
+}
+
+template <typename T>
+void tupla::sortsaispar<T>::commit_block(size_t b, T * bkt)
+{
+	size_t p, n;
+	block_range(b, p, n);
+
+	T * block_seen = seen[b & 1];
+	uint16 * block_code = code[b & 1];
+
+	// Suffixes written after block was prepared are looked up again
+	if (scan_left) {
+		for (size_t i = 0 ; i < n ; ++i) {
+			size_t j = scan_sa[p + i];
+			uint16 c = (j == block_seen[i] ? block_code[i] : induced(j));
+			if (c != NoInduce)
+				index_store(scan_sa + bkt[c]++, j-1);
+		}
+	}
+	else {
+		for (size_t i = n ; i-- > 0 ; ) {
+			size_t j = scan_sa[p + i];
+			uint16 c = (j == block_seen[i] ? block_code[i] : induced(j));
+			if (c != NoInduce)
+				index_store(scan_sa + --bkt[c], j-1);
+		}
+	}
+}
+
+template class tupla::sortsaispar<uint32>;
+template class tupla::sortsaispar<uint64>;
+template class tupla::sortsaispar<uint40>;
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,189 @@
+/**
+ * Induced suffix sort. Parallel implementation requires 5n memory with
+ * 32-bit indices, plus buckets for the reduced problems as in sortsais.
+ *
+ * Classifies suffixes, fills buckets with LMS suffixes and counts
+ * characters of input text in parallel. Induce scans on input text are
+ * pipelined: while one thread scans and commits a block of suffix array,
+ * the other threads look up types and characters preceding suffixes in
+ * the next block. Reduced problems are sorted sequentially. LCP array is
+ * built from irreducible values of permuted LCP array in parallel.
+ *
+ * Based on:
+ * G. Nong, S. Zhang & W. H. Chan 2009: Linear Suffix Array Construction
+ * by Almost Pure Induced-Sorting. DCC 2009, 193-202
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <boost/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/bind.hpp>
+
+#include "numdefs.hpp"
+#include "sortsais.hpp"
+#include "scheduler.hpp"
+
+namespace tupla {
+
+template <typename T = uint32>
+class sortsaispar : public sortsais<T> {
+
+private:
+	using suffixsort<T>::sa;
+	using suffixsort<T>::isa;
+	using suffixsort<T>::lcp;
+	using suffixsort<T>::len;
+	using suffixsort<T>::opts;
+	using suffixsort<T>::alloc_flags;
+	using suffixsort<T>::work_flags;
+	using suffixsort<T>::report_pages;
+	using suffixsort<T>::err;
+	using suffixsort<T>::finished_sa;
+	using suffixsort<T>::finished_lcp;
+	using suffixsort<T>::count_range;
+	using suffixsort<T>::irreducible_range;
+	using suffixsort<T>::fill_plcp_range;
+	using suffixsort<T>::plcp_carries;
+	using suffixsort<T>::carry_plcp_range;
+	using suffixsort<T>::permute_lcp_range;
+	using sortsais<T>::Empty;
+	using sortsais<T>::count;
+	using sortsais<T>::stype;
+	using sortsais<T>::set_stype;
+	using sortsais<T>::is_lms;
+	using sortsais<T>::get_buckets;
+
+	sortsaispar(const sortsaispar&);
+	sortsaispar& operator=(const sortsaispar&);
+
+	// Preceding suffix is not induced in this scan
+	static const uint16 NoInduce = 0x100;
+
+	// Number of concurrent threads to run
+	const uint32 jobs;
+
+	// Share of text length per job, multiple of 64 to keep type bits
+	// of each range in separate bytes
+	size_t chunk;
+
+	// Share of text length per job for input length
+	inline size_t chunk_length(const size_t n) const
+	{
+		return std::min( (std::max((size_t)BucketSize, (n/jobs) + 1) + 63)
+				& ~(size_t)63, n);
+	}
+
+	// Suffix seen in block while preparing and the character preceding
+	// it, double buffered for scanning and preparing next block
+	T * seen[2];
+	uint16 * code[2];
+
+	// Induce scan state shared with preparing threads
+	const uint8 * scan_text;
+	const uint8 * scan_types;
+	T * scan_sa;
+	size_t scan_n;
+	size_t scan_blocks;
+	bool scan_left;
+	boost::barrier * scan_sync;
+
+	// Workers for all parallel phases
+	scheduler sched;
+
+	// Invoke function parallel for each thread's range in input, range j
+	// always runs on worker j
+	template <class F>
+	void parallel_chunk(F fun_range)
+	{
+		sched.parallel_for(fun_range, 0, len, chunk, true);
+	}
+
+	// Range p..p+n-1 of block b in scan order
+	inline void block_range(size_t b, size_t& p, size_t& n)
+	{
+		if (scan_left) {
+			p = b * BucketSize;
+			n = std::min((size_t)BucketSize, scan_n - p);
+		}
+		else {
+			size_t e = scan_n - b * BucketSize;
+			p = (e > BucketSize ? e - BucketSize : 0);
+			n = e - p;
+		}
+	}
+
+	// Character preceding suffix j if it is induced in this scan. Packed
+	// indices read while being written may be torn, so values outside
+	// the text are not looked up; Empty is one of them
+	inline uint16 induced(const size_t j)
+	__attribute__((always_inline))
+	{
+		return ((j < scan_n && j > 0 && stype(scan_types, j-1) != scan_left)
+				? scan_text[j-1] : NoInduce);
+	}
+
+	// Classify suffixes in range
+	void classify_range(const uint8 *, uint8 *, size_t, size_t);
+
+	// Empty range in suffix array
+	void empty_range(T *, size_t, size_t);
+
+	// Count LMS suffixes in range for each character
+	void count_lms_range(const uint8 *, const uint8 *, size_t *, size_t,
+			size_t, uint32);
+
+	// Place LMS suffixes in range to thread's offsets in buckets
+	void place_lms_range(const uint8 *, const uint8 *, T *, size_t *,
+			size_t, size_t, uint32);
+
+	// Prepare share part/parts of block b
+	void prepare_block(size_t, uint32, uint32);
+
+	// Scan block b and induce preceding suffixes
+	void commit_block(size_t, T *);
+
+	// Prepare following blocks while first thread commits
+	void scan_worker(uint32);
+
+	// Task running scan worker j
+	static void scan_task(void * obj, size_t j, size_t)
+	{
+		((sortsaispar *)obj)->scan_worker(j);
+	}
+
+	// Pipelined induce scan to direction
+	void induce(const uint8 *, const uint8 *, T *, T *, size_t,
+			size_t, bool);
+
+protected:
+	virtual uint32 init();
+
+	virtual void classify(const uint8 *, uint8 *, size_t);
+	virtual void place_lms(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+	virtual void induce_l(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+	virtual void induce_s(const uint8 *, const uint8 *, T *, T *,
+			size_t, size_t);
+	virtual size_t tasks_scheduled() { return sched.tasks(); }
+	virtual size_t lcp_chunk() { return chunk; }
+	virtual void run_chunks(const typename suffixsort<T>::range_fun& fun)
+	{
+		parallel_chunk(fun);
+	}
+
+public:
+
+	sortsaispar(const char *, const size_t, const uint32, std::ostream&,
+			const sortopts&);
+	virtual ~sortsaispar();
+	virtual void reset(const char *, const size_t);
+
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -4,84 +4,34 @@
 
 using namespace tupla;
 
-tupla::sortseq::sortseq(const char * text, const uint32 len, std::ostream& err)
-	: suffixsort(text, len, err)
+template <typename T>
+tupla::sortseq<T>::sortseq(const char * text, const size_t len, 
+		std::ostream& err, const sortopts& opts)
+	: suffixsort<T>(text, len, err, opts)
 {
 }
 
-tupla::sortseq::~sortseq()
+template <typename T>
+tupla::sortseq<T>::~sortseq()
 {
 }
 
-void tupla::sortseq::build_lcp()
+template <typename T>
+uint32 tupla::sortseq<T>::init()
 {
-	if (!finished_sa) {
-		throw std::runtime_error("suffix array not complete");
-	}
-
-	if (finished_lcp) return;
-
-	err << SELF << ": building longest common prefix array via permuted" << std::endl;
-
-	lcp = new uint32[len];
-	memset(lcp, 0, (len * sizeof(uint32)) );
-
-	// Use throwaway inverse suffix array table for PLCP
-	uint32 * plcp = isa;
-	
-	// Use allocated LCP temorarily for phi
-	uint32 * phi = lcp;
-
-	// Compute phi for q=1
-	for (size_t i = 1 ; i < len ; ++i)
-		phi[ sa[i] ] = sa[i-1];
-	
-	// Turn phi into PLCP 
-	uint32 l = 0;
-	for (size_t i = 0 ; i < len-1 ; ++i) {
-		uint32 j = phi[i];
-		plcp[i] = (l += lcplen(i+l, j+l));
-		l = ( l >= 1 ? l - 1 : 0);
-	}
-
-	// Compute irreducible LCP values
-	for (size_t i = 1 ; i < len ; ++i) {
-		uint32 j = sa[i - 1];
-		uint32 k = sa[i];
-		// Wrap around t[-1]
-		if ( j == 0 || k == 0  || *(text + j - 1) != *(text + k - 1) ) {
-			l = lcplen(j, k);
-			if (plcp[k] < l) 
-				plcp[k] = l;
-		}
-	}
-
-	// Fill in the other values
-	for (size_t i = 1 ; i < len-1 ; ++i) 
-		if (plcp[i] + 1 < plcp[i-1])
-			plcp[i] = plcp[i-1] - 1;
-	
-	// Build LCP from PLCP permutation
-	for (size_t i = 0 ; i < len ; ++i)
-		lcp[i] = plcp[ sa[i] ];
-
-	finished_lcp = true;
-}
-
-uint32 tupla::sortseq::init()
-{
-	uint32 group[Alpha] = { Z256 };
-	uint32 count[Alpha] = { Z256 };
+	size_t group[Alpha] = { Z256 };
+	size_t count[Alpha] = { Z256 };
 	uint8 sorted[Alpha] = { Z256 };
 	
-	sa = new uint32[len];
-	isa = new uint32[len];
+	sa = alloc_array<T>(len, opts.sa_file, alloc_flags(), opts.pool);
+	isa = alloc_array<T>(len, std::string(), alloc_flags(), opts.pool);
 
-	memset(sa, 0, (len * sizeof(uint32)) );
-	memset(isa, 0, (len * sizeof(uint32)) );
+	memset(sa, 0, (len * sizeof(T)) );
+	memset(isa, 0, (len * sizeof(T)) );
 
-	// Count character occurences
-	count_range(0, len, count, 0);
+	// Count character occurences, unless counted while reading
+	if (opts.text_count) memcpy(count, opts.text_count, (Alpha * sizeof(size_t)));
+	else count_range(0, len, count, 0);
 
 	// Multiple nulls in input
 	if (count[0] != 1) 
@@ -96,18 +46,25 @@ uint32 tupla::sortseq::init()
 	return alphasize;
 }
 
-void tupla::sortseq::doubling()
+template <typename T>
+void tupla::sortseq<T>::doubling()
 {
-	doubling_range(0, len);
+	std::vector<interval> next;
+	for (size_t r = 0 ; r < unsorted.size() ; ++r)
+		doubling_range(unsorted[r].p, unsorted[r].n, next);
+
+	unsorted.swap(next);
 }
 
-void tupla::sortseq::doubling_range(uint32 p, size_t n) 
+template <typename T>
+void tupla::sortseq<T>::doubling_range(size_t p, size_t n,
+		std::vector<interval>& next) 
 {
-	uint32 sp = 0; // Starting index of sorted group
-	uint32 sl = 0; // Sorted groups length following start
+	size_t sp = p; // Starting index of sorted group
+	size_t sl = 0; // Sorted groups length following start
 	for (size_t i = p ; i < p+n-1 ; ) {
 		// Skip sorted group
-		if (uint32 s = get_sorted(i)) {
+		if (size_t s = get_sorted(i)) {
 			i += s; sl += s;
 			continue;
 		} 
@@ -117,17 +74,24 @@ void tupla::sortseq::doubling_range(uint32 p, size_t n)
 			sl = 0;
 		}
 		// Sort unsorted group i..g
-		uint32 g = isa[ sa[i] ] + 1;
-		groups += tqsort(i, g-i);
+		size_t g = isa[ sa[i] ] + 1;
+		size_t ns = tqsort(i, g-i);
+		if (ns < g-i) add_unsorted(next, i, g-i);
+		groups += ns;
 		sp = i = g;
 	}
 	// Combine sorted group at end
 	if (sl > 0) set_sorted(sp, sl);
 }
 
-void tupla::sortseq::invert()
+template <typename T>
+void tupla::sortseq<T>::invert()
 {
 	invert_range(0, len);
 }
 
+template class tupla::sortseq<uint32>;
+template class tupla::sortseq<uint64>;
+template class tupla::sortseq<uint40>;
+
 // vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -1,5 +1,6 @@
 /**
- * Doubling suffix sort. Sequential implementation requires 8n memory.
+ * Doubling suffix sort. Sequential implementation requires 8n memory
+ * with 32-bit indices, 10n with packed 40-bit indices.
  *
  * @author jkataja
  */
@@ -14,22 +15,40 @@
 
 namespace tupla {
 
-class sortseq : public suffixsort {
+template <typename T = uint32>
+class sortseq : public suffixsort<T> {
 private:
 	sortseq(const sortseq&);
 	sortseq& operator=(const sortseq&);
 
 protected:
+	using suffixsort<T>::sa;
+	using suffixsort<T>::isa;
+	using suffixsort<T>::len;
+	using suffixsort<T>::opts;
+	using suffixsort<T>::alloc_flags;
+	using suffixsort<T>::report_pages;
+	using suffixsort<T>::groups;
+	using suffixsort<T>::count_range;
+	using suffixsort<T>::build_prefix;
+	using suffixsort<T>::sort_range;
+	using suffixsort<T>::invert_range;
+	using suffixsort<T>::tqsort;
+	using suffixsort<T>::get_sorted;
+	using suffixsort<T>::set_sorted;
+	using suffixsort<T>::unsorted;
+	using suffixsort<T>::add_unsorted;
+
+	typedef typename suffixsort<T>::interval interval;
 
 	virtual uint32 init();
 	virtual void doubling();
-	virtual void doubling_range(uint32, size_t);
+	virtual void doubling_range(size_t, size_t, std::vector<interval>&);
 	virtual void invert();
 
 public:
-	sortseq(const char *, const uint32, std::ostream&);
+	sortseq(const char *, const size_t, std::ostream&, const sortopts&);
 	virtual ~sortseq();
-	virtual void build_lcp();
 
 };
 
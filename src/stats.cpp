@@ -0,0 +1,111 @@
+#include "stats.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <iomanip>
+
+using namespace tupla;
+
+// Seconds of clock
+static double clock_seconds(clockid_t id)
+{
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+// Write string quoted and escaped for JSON
+static void write_string(std::ostream& out, const std::string& s)
+{
+	out << '"';
+	for (size_t i = 0 ; i < s.size() ; ++i) {
+		const unsigned char c = s[i];
+		if (c == '"' || c == '\\') out << '\\' << c;
+		else if (c < 0x20) {
+			char esc[8];
+			snprintf(esc, sizeof(esc), "\\u%04x", c);
+			out << esc;
+		}
+		else out << c;
+	}
+	out << '"';
+}
+
+tupla::stats_clock::stats_clock()
+	: wall( clock_seconds(CLOCK_MONOTONIC) ), 
+	  cpu( clock_seconds(CLOCK_PROCESS_CPUTIME_ID) )
+{
+}
+
+void tupla::sortstats::set(const std::string& name, const std::string& value)
+{
+	boost::mutex::scoped_lock guard(lock);
+	info.push_back( std::make_pair(name, value) );
+}
+
+void tupla::sortstats::set(const std::string& name, const uint64 value)
+{
+	boost::mutex::scoped_lock guard(lock);
+	counters.push_back( std::make_pair(name, value) );
+}
+
+void tupla::sortstats::add_phase(const std::string& name, 
+		const stats_clock& start)
+{
+	stats_clock now;
+	boost::mutex::scoped_lock guard(lock);
+	phases.push_back( phase{ name, (now.wall - start.wall), 
+			(now.cpu - start.cpu) } );
+}
+
+void tupla::sortstats::add_round(const uint64 h, const size_t tasks,
+		const size_t groups, const std::vector<size_t>& sizes, 
+		const stats_clock& start, const stats_clock& end)
+{
+	boost::mutex::scoped_lock guard(lock);
+	rounds.push_back( round{ h, (end.wall - start.wall), 
+			(end.cpu - start.cpu), tasks, groups, sizes } );
+}
+
+void tupla::sortstats::write_json(std::ostream& out)
+{
+	boost::mutex::scoped_lock guard(lock);
+
+	out << "{" << std::fixed << std::setprecision(6);
+	for (size_t i = 0 ; i < info.size() ; ++i) {
+		out << "\n  ";
+		write_string(out, info[i].first);
+		out << ": ";
+		write_string(out, info[i].second);
+		out << ",";
+	}
+	for (size_t i = 0 ; i < counters.size() ; ++i) {
+		out << "\n  ";
+		write_string(out, counters[i].first);
+		out << ": " << counters[i].second << ",";
+	}
+
+	out << "\n  \"phases\": [";
+	for (size_t i = 0 ; i < phases.size() ; ++i) {
+		out << (i ? "," : "") << "\n    {\"name\": ";
+		write_string(out, phases[i].name);
+		out << ", \"wall\": " << phases[i].wall 
+			<< ", \"cpu\": " << phases[i].cpu << "}";
+	}
+	out << (phases.empty() ? "" : "\n  ") << "],";
+
+	out << "\n  \"rounds\": [";
+	for (size_t i = 0 ; i < rounds.size() ; ++i) {
+		const round& r = rounds[i];
+		out << (i ? "," : "") << "\n    {\"h\": " << r.h
+			<< ", \"wall\": " << r.wall << ", \"cpu\": " << r.cpu
+			<< ", \"tasks\": " << r.tasks << ", \"singletons\": " << r.groups
+			<< ", \"group_sizes\": [";
+		for (size_t k = 0 ; k < r.sizes.size() ; ++k)
+			out << (k ? ", " : "") << r.sizes[k];
+		out << "]}";
+	}
+	out << (rounds.empty() ? "" : "\n  ") << "]\n}" << std::endl;
+}
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -0,0 +1,81 @@
+/**
+ * Timing and counters of sorting phases, reported as JSON so that runs
+ * over many inputs can be compared automatically. Phases record wall
+ * clock and process CPU time. Doubling rounds also record tasks
+ * scheduled and the histogram of group sizes after the round.
+ *
+ * @author jkataja
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+#include "numdefs.hpp"
+
+namespace tupla {
+
+// Wall clock and process CPU time in seconds at construction
+struct stats_clock
+{
+	stats_clock();
+
+	double wall;
+	double cpu;
+};
+
+class sortstats {
+
+public:
+	struct phase {
+		std::string name;
+		double wall; // Seconds of wall clock time
+		double cpu; // Seconds of CPU time in all threads
+	};
+
+	struct round {
+		uint64 h; // Prefix length sorted by round
+		double wall;
+		double cpu;
+		size_t tasks; // Tasks scheduled during round
+		size_t groups; // Singleton groups after round
+		std::vector<size_t> sizes; // Groups of 2^k..2^(k+1)-1 suffixes
+	};
+
+private:
+	sortstats(const sortstats&);
+	sortstats& operator=(const sortstats&);
+
+	std::vector< std::pair<std::string, std::string> > info;
+	std::vector< std::pair<std::string, uint64> > counters;
+	std::vector<phase> phases;
+	std::vector<round> rounds;
+
+	boost::mutex lock;
+
+public:
+	sortstats() { }
+
+	// Describe run with named string or number
+	void set(const std::string&, const std::string&);
+	void set(const std::string&, const uint64);
+
+	// Add phase started at clock and ending now
+	void add_phase(const std::string&, const stats_clock&);
+
+	// Add doubling round of prefix length h between clocks, with tasks
+	// scheduled, singleton groups and group histogram
+	void add_round(const uint64, const size_t, const size_t,
+			const std::vector<size_t>&, const stats_clock&, 
+			const stats_clock&);
+
+	// Write all as one JSON object
+	void write_json(std::ostream&);
+};
+
+} // namespace
+
+// vim:set ts=4 sts=4 sw=4 noexpandtab:
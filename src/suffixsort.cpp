@@ -2,55 +2,166 @@
 #include "tupla.hpp"
 #include "sortseq.hpp"
 #include "sortpar.hpp"
+#include "sortsais.hpp"
+#include "sortsaispar.hpp"
+#include "stats.hpp"
 
 #include <stdexcept>
 #include <iomanip>
 #include <algorithm>
 #include <cstring>
+#include <type_traits>
+#include <fstream>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 #include <boost/thread/thread.hpp>
 
 using namespace tupla;
 
-suffixsort::suffixsort(const char * text, const uint32 len, std::ostream& err)
+// Sorting state saved after doubling round, followed by unsorted
+// intervals, suffix array and inverse suffix array
+struct checkpoint_header {
+	uint64 magic;
+	uint64 index_size;
+	uint64 len;
+	uint64 h;
+	uint64 groups;
+	uint64 intervals;
+	uint64 text_hash;
+};
+
+static const uint64 CheckpointMagic = 0x326B6370616C7574ULL; // tuplacp2
+
+// Write all bytes to file descriptor
+static bool write_all(int fd, const void * data, size_t n)
+{
+	const char * p = (const char *)data;
+	while (n > 0) {
+		ssize_t w = write(fd, p, n);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0) return false;
+		p += w;
+		n -= w;
+	}
+	return true;
+}
+
+template <typename T>
+suffixsort<T>::suffixsort(const char * text, const size_t len, 
+		std::ostream& err, const sortopts& opts)
 	: sa(0), isa(0), lcp(0), h(0), text(text), len(len), groups(0),
-	  err(err), finished_sa(false), finished_lcp(false)
+	  err(err), opts(opts), finished_sa(false), finished_lcp(false),
+	  checkpoint_pid(0), checkpoint_hash(0)
 {
 }
 
-suffixsort::~suffixsort()
+template <typename T>
+suffixsort<T>::~suffixsort()
 {
-	delete [] sa;
-	delete [] isa;
-	delete [] lcp;
+	wait_checkpoint();
+	free_array(sa);
+	free_array(isa);
+	free_array(lcp);
 }
 
-suffixsort * tupla::suffixsort::instance(const char * text, 
-		const uint32 len, const uint32 jobs, std::ostream& err)
+template <typename T>
+suffixsort<T> * tupla::suffixsort<T>::instance(const char * text, 
+		const size_t len, const uint32 jobs, std::ostream& err,
+		const sortopts& opts)
 {
+	err << SELF << ": using " << simd_name( simd_supported() ) 
+			<< " kernels" << std::endl;
+
+	if (opts.algorithm == AlgorithmInduced) {
+		if (jobs > 1) {
+			err << SELF << ": using parallel induced sorting algorithm with "
+					<< jobs << " jobs" << std::endl;
+			return new sortsaispar<T>(text, len, jobs, err, opts);
+		}
+		err << SELF << ": using sequential induced sorting algorithm" 
+				<< std::endl;
+		return new sortsais<T>(text, len, err, opts);
+	}
+	if (opts.algorithm != AlgorithmDoubling) {
+		throw std::runtime_error("unknown algorithm");
+	}
 	if (jobs > 1) {
 		err << SELF << ": using parallel algorithm with " << jobs 
 				<< " jobs" << std::endl;
-		return new sortpar(text, len, jobs, err);
+		return new sortpar<T>(text, len, jobs, err, opts);
 	}
 	else {
 		err << SELF << ": using sequential algorithm" << std::endl;
-		return new sortseq(text, len, err);
+		return new sortseq<T>(text, len, err, opts);
 	}
 }
 
-void tupla::suffixsort::build_sa()
+template <typename T>
+void tupla::suffixsort<T>::reset(const char * text, const size_t len)
+{
+	wait_checkpoint();
+
+	free_array(sa);
+	free_array(isa);
+	free_array(lcp);
+	sa = isa = lcp = 0;
+
+	this->text = text;
+	this->len = len;
+	h = 0;
+	groups = 0;
+	unsorted.clear();
+	finished_sa = false;
+	finished_lcp = false;
+}
+
+template <typename T>
+void tupla::suffixsort<T>::build_sa()
 {
 	if (finished_sa) return;
 
 	// Allocate and initialize with counting sort
+	stats_clock start;
 	uint32 alphasize = init();
 	err << SELF << ": alphabet size " << alphasize << std::endl;
+	if (opts.stats) opts.stats->add_phase("init", start);
+
+	report_pages("suffix array", sa);
+	report_pages("inverse suffix array", isa);
+
+	unsorted.assign(1, interval{ 0, len });
+	h = 1;
+
+	// Continue from round after last saved round
+	if (opts.resume) {
+		if (restore()) {
+			err << SELF << ": resuming after doubling " << ffsl(h)
+					<< " with " << groups << " singleton groups" << std::endl;
+			h <<= 1;
+		}
+		else {
+			err << SELF << ": no checkpoint, starting from first round"
+					<< std::endl;
+		}
+	}
 
 	// Doubling steps until number of sorting groups matches length
 	uint32 precision = 1;
-	for (h = 1 ; (groups < len && h < len) ; h <<= 1) {
+	for ( ; (groups < len && h < len) ; h <<= 1) {
+		stats_clock round_start;
+		size_t tasks = tasks_scheduled();
+
+		limit_checkpoint();
 		doubling();
 
+		if (opts.stats) {
+			stats_clock round_end;
+			opts.stats->add_round(h, (tasks_scheduled() - tasks), groups,
+					group_sizes(), round_start, round_end);
+		}
+
 		double done = groups/(double)len;
 		if (groups == len) precision = 1;
 		else if (done >= 0.9995) ++precision;
@@ -59,6 +170,12 @@ void tupla::suffixsort::build_sa()
 				<< " with " << groups << " singleton groups ("
 				<< std::fixed << std::setprecision(precision) << (done * 100) 
 				<< "% complete)" << std::endl;
+
+		if (!opts.checkpoint.empty()) checkpoint();
+	}
+
+	if (!wait_checkpoint()) {
+		err << SELF << ": could not write checkpoint" << std::endl;
 	}
 
 	if (groups != len) {
@@ -67,22 +184,218 @@ void tupla::suffixsort::build_sa()
 
 	// Invert inverse suffix array
 	err << SELF << ": inverting inverse suffix array" << std::endl;
+	stats_clock invert_start;
 	invert();
+	if (opts.stats) opts.stats->add_phase("invert", invert_start);
 
 	finished_sa = true;
 }
 
+template <typename T>
+void tupla::suffixsort<T>::report_pages(const char * name, const void * data)
+{
+	if (!opts.hugepages || data == 0) return;
+
+	err << SELF << ": " << name << " on " << describe_pages(data) 
+			<< std::endl;
+}
+
+template <typename T>
+std::vector<size_t> tupla::suffixsort<T>::group_sizes()
+{
+	std::vector<size_t> sizes(1, groups);
+
+	// Unsorted groups end at their group number
+	for (size_t r = 0 ; r < unsorted.size() ; ++r) {
+		const size_t e = unsorted[r].p + unsorted[r].n;
+		for (size_t p = unsorted[r].p, s ; p < e ; p += s) {
+			if ((s = get_sorted(p))) continue;
+
+			s = (size_t)isa[ sa[p] ] + 1 - p;
+			const size_t k = (63 - __builtin_clzl(s));
+			if (sizes.size() <= k) sizes.resize(k + 1);
+			++sizes[k];
+		}
+	}
+
+	return sizes;
+}
+
+template <typename T>
+void tupla::suffixsort<T>::checkpoint()
+{
+	// Keep one checkpoint in progress, replacing file after it is complete
+	if (!wait_checkpoint()) {
+		err << SELF << ": could not write checkpoint" << std::endl;
+	}
+
+	checkpoint_header header = { CheckpointMagic, sizeof(T), len, h, groups,
+			unsorted.size(), input_hash() };
+	const std::string& name = opts.checkpoint;
+	const std::string tmp_name = name + ".tmp";
+
+	err << std::flush;
+	pid_t pid = fork();
+	if (pid < 0) {
+		err << SELF << ": could not start writing checkpoint" << std::endl;
+		return;
+	}
+
+	// Copy of process writes its memory as of this round, using only
+	// system calls since other threads are not copied
+	if (pid == 0) {
+		int fd = open(tmp_name.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+		bool ok = (fd >= 0)
+			&& write_all(fd, &header, sizeof(header))
+			&& write_all(fd, unsorted.data(), (unsorted.size() * sizeof(interval)))
+			&& write_all(fd, sa, (len * sizeof(T)))
+			&& write_all(fd, isa, (len * sizeof(T)))
+			&& (fsync(fd) == 0);
+		ok = (fd >= 0) && (close(fd) == 0) && ok
+			&& (rename(tmp_name.c_str(), name.c_str()) == 0);
+		_exit(ok ? 0 : 1);
+	}
+
+	checkpoint_pid = pid;
+}
+
+template <typename T>
+bool tupla::suffixsort<T>::wait_checkpoint()
+{
+	if (checkpoint_pid == 0) return true;
+
+	int status = 0;
+	pid_t pid = waitpid(checkpoint_pid, &status, 0);
+	checkpoint_pid = 0;
+
+	return (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+template <typename T>
+void tupla::suffixsort<T>::limit_checkpoint()
+{
+	if (checkpoint_pid == 0) return;
+
+	// Round writes suffix array in unsorted intervals, and inverse suffix
+	// array and assignment array at their suffixes, each page copied once
+	size_t u = 0;
+	for (size_t r = 0 ; r < unsorted.size() ; ++r)
+		u += unsorted[r].n;
+	const size_t page = sysconf(_SC_PAGESIZE);
+	const size_t copied = (u * sizeof(T))
+			+ 2 * std::min((u * page), (len * sizeof(T)));
+
+	if (copied > (len * sizeof(T)) / CheckpointCopy && !wait_checkpoint()) {
+		err << SELF << ": could not write checkpoint" << std::endl;
+	}
+}
 
-uint32 tupla::suffixsort::tqsort(uint32 p, size_t n)
+template <typename T>
+uint64 tupla::suffixsort<T>::input_hash()
 {
-	uint32 a,b,c,d;
-	uint32 sv,tv;
-	uint32 pn = p + n;
+	if (checkpoint_hash != 0) return checkpoint_hash;
+
+	// FNV-1a over 64-bit words of input
+	uint64 hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0 ; i < len ; i += 8) {
+		uint64 word = 0;
+		memcpy(&word, (text + i), std::min((size_t)8, len - i));
+		hash = (hash ^ word) * 0x100000001B3ULL;
+	}
+	checkpoint_hash = (hash != 0 ? hash : 1);
+
+	return checkpoint_hash;
+}
+
+template <typename T>
+bool tupla::suffixsort<T>::restore()
+{
+	std::ifstream in(opts.checkpoint.c_str(), std::ios::binary);
+	if (!in.is_open()) return false;
+
+	checkpoint_header header;
+	in.read((char *)&header, sizeof(header));
+	if (!in || header.magic != CheckpointMagic 
+			|| header.index_size != sizeof(T) || header.len != len
+			|| header.text_hash != input_hash()) {
+		throw std::runtime_error("checkpoint does not match input");
+	}
+
+	unsorted.resize(header.intervals);
+	in.read((char *)unsorted.data(), (unsorted.size() * sizeof(interval)));
+	in.read((char *)sa, (len * sizeof(T)));
+	in.read((char *)isa, (len * sizeof(T)));
+	if (!in) {
+		throw std::runtime_error("could not read checkpoint");
+	}
+
+	h = header.h;
+	groups = header.groups;
+	restored();
+
+	return true;
+}
+
+template <typename T>
+void tupla::suffixsort<T>::build_lcp()
+{
+	if (!finished_sa) {
+		throw std::runtime_error("suffix array not complete");
+	}
+
+	if (finished_lcp) return;
+
+	err << SELF << ": building longest common prefix array via permuted" << std::endl;
+
+	lcp = alloc_array<T>(len, opts.lcp_file, alloc_flags(), opts.pool);
+
+	// Use throwaway inverse suffix array table for PLCP
+	if (isa == 0) 
+		isa = alloc_array<T>(len, std::string(), alloc_flags(), opts.pool);
+	T * plcp = isa;
+
+	// Compute irreducible LCP values
+	run_chunks( [this, plcp](size_t p, size_t n, uint32) { 
+			irreducible_range(plcp, p, n); } );
+
+	// Fill reducible values within each range, then carry values over
+	// range boundaries as prefix over the ranges
+	run_chunks( [this, plcp](size_t p, size_t n, uint32) { 
+			fill_plcp_range(plcp, p, n); } );
+
+	const size_t chunk = lcp_chunk();
+	size_t * carry = alloc_array<size_t>( (len + chunk - 1) / chunk,
+			std::string(), work_flags(), opts.pool);
+	plcp_carries(plcp, chunk, carry);
+	run_chunks( [this, plcp, carry](size_t p, size_t n, uint32 j) { 
+			carry_plcp_range(plcp, carry, p, n, j); } );
+	free_array(carry);
+
+	// Build LCP from PLCP permutation
+	run_chunks( [this, plcp](size_t p, size_t n, uint32) { 
+			permute_lcp_range(plcp, p, n); } );
+
+	report_pages("LCP array", lcp);
+
+	finished_lcp = true;
+}
+
+template <typename T>
+size_t tupla::suffixsort<T>::tqsort(size_t p, size_t n)
+{
+	size_t a,b,c,d;
+	size_t sv,tv;
+	size_t pn = p + n;
 
 	// Sort small tables with selection sort 
 	if (n < 7) return sort_small(p, n);
+
+	// Sort on gathered keys once group fits in gather buffer
+	if (opts.gather && n < BucketSize) {
+		return kvsort(p, n, [this](size_t f, size_t m) { assign(f, m); });
+	}
 	
-	const uint64 v = choose_pivot(p, n);
+	const size_t v = choose_pivot(p, n);
 
 	// Partition
 	a = b = p;
@@ -90,7 +403,7 @@ uint32 tupla::suffixsort::tqsort(uint32 p, size_t n)
 
 	// Assume on range i=f..g value ISA_h[ SA_h[i] ] is equal
 	// Only use the doubling part  ISA_h[ SA_h[i] + h ] as comparison key
-	sv = (v & 0xFFFFFFFF);
+	sv = v;
 	for (;;) {
 		while (b <= c && (tv = isa[ sa[b] + h ]) <= sv) {
 			if (tv == sv) swap(a++, b); 
@@ -105,16 +418,16 @@ uint32 tupla::suffixsort::tqsort(uint32 p, size_t n)
 	}
 
 	// Move split-end group to middle
-	const uint32 s = std::min(a-p, b-a ); vecswap(p, b-s, s);
-	const uint32 t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
+	const size_t s = std::min(a-p, b-a ); vecswap(p, b-s, s);
+	const size_t t = std::min(d-c, pn-1-d); vecswap(b, pn-t, t);
 
-	const uint32 ltn = b-a;
-	const uint32 gtn = d-c;
-	const uint32 eqn = n - ltn - gtn;
+	const size_t ltn = b-a;
+	const size_t gtn = d-c;
+	const size_t eqn = n - ltn - gtn;
 
 	// New singleton groups in ranges less than and greater than pivot
-	uint32 lts = 0;
-	uint32 gts = 0;
+	size_t lts = 0;
+	size_t gts = 0;
 
 	if (ltn > 0) lts = tqsort(p, ltn);
 	assign(p+ltn, eqn); 
@@ -123,36 +436,160 @@ uint32 tupla::suffixsort::tqsort(uint32 p, size_t n)
 	return (lts + (eqn == 1) + gts);
 }
 
-void tupla::suffixsort::lcp_range(uint32 p, uint32 n)
+template <typename T>
+typename tupla::suffixsort<T>::keyed * tupla::suffixsort<T>::kv_gather(
+		size_t p, size_t n)
 {
-	uint32 l = 0;
-	for (size_t i = p ; i < p+n-1 ; ++i) {
-		uint32 k = isa[i];
-		uint32 j = sa[k - 1];
-		lcp[k] = lcplen(i+l, j+l);
-		if (l > 0) --l;
+	std::vector<keyed> * buffer = keyed_buffer.get();
+	if (buffer == 0) keyed_buffer.reset(buffer = new std::vector<keyed>());
+	if (buffer->size() < n) buffer->resize(n);
+	keyed * kv = &(*buffer)[0];
+
+	// Vectorized gather with 32-bit indices
+	if (std::is_same<T, uint32>::value) {
+		gather_kernel((const uint32 *)isa + h, (const uint32 *)(sa + p), n, 
+				(uint32 *)kv);
+		return kv;
+	}
+
+	for (size_t i = 0 ; i < n ; ++i) {
+		const size_t v = sa[p+i];
+		kv[i].key = isa[v + h];
+		kv[i].pos = v;
 	}
+
+	return kv;
 }
 
-void tupla::suffixsort::count_range(uint32 p, uint32 n, uint32 * range_count, 
+template <typename T>
+void tupla::suffixsort<T>::kv_tqsort(keyed * kv, size_t n)
+{
+	// Insertion sort on small arrays
+	if (n < 7) {
+		for (size_t i = 1 ; i < n ; ++i)
+			for (size_t j = i ; j > 0 && kv[j-1].key > kv[j].key ; --j)
+				std::swap(kv[j-1], kv[j]);
+		return;
+	}
+
+	// Pivot is median of three, pseudomedian of nine on big arrays
+	size_t pa = 0;
+	size_t pb = n/2;
+	size_t pc = n-1;
+	if (n > 40) {
+		size_t s = (n/8);
+		pa = kv_med3(kv, pa, pa+s, pa+2*s);
+		pb = kv_med3(kv, pb-s, pb, pb+s);
+		pc = kv_med3(kv, pc-2*s, pc-s, pc);
+	}
+	const size_t sv = kv[ kv_med3(kv, pa, pb, pc) ].key;
+
+	// Partition, signed indices as c passes below first element
+	long a, b, c, d;
+	size_t tv;
+	a = b = 0;
+	c = d = n-1;
+	for (;;) {
+		while (b <= c && (tv = kv[b].key) <= sv) {
+			if (tv == sv) std::swap(kv[a++], kv[b]);
+			++b;
+		}
+		while (c >= b && (tv = kv[c].key) >= sv) {
+			if (tv == sv) std::swap(kv[c], kv[d--]);
+			--c;
+		}
+		if (b > c) break;
+		std::swap(kv[b++], kv[c--]);
+	}
+
+	// Move split-end group to middle
+	const long s = std::min(a, b-a);
+	std::swap_ranges(kv, kv+s, kv+b-s);
+	const long t = std::min(d-c, (long)n-1-d);
+	std::swap_ranges(kv+b, kv+b+t, kv+n-t);
+
+	if (b-a > 1) kv_tqsort(kv, b-a);
+	if (d-c > 1) kv_tqsort(kv+n-(d-c), d-c);
+}
+
+template <typename T>
+void tupla::suffixsort<T>::irreducible_range(T * plcp, size_t p, size_t n)
+{
+	// Null terminator is first in suffix array
+	if (p == 0) plcp[ sa[0] ] = 0;
+
+	for (size_t i = std::max(p, (size_t)1) ; i < p+n ; ++i) {
+		const size_t j = sa[i - 1];
+		const size_t k = sa[i];
+		// Wrap around t[-1]
+		if ( j == 0 || k == 0  || *(text + j - 1) != *(text + k - 1) )
+			plcp[k] = lcplen(j, k);
+		else
+			plcp[k] = 0;
+	}
+}
+
+template <typename T>
+void tupla::suffixsort<T>::fill_plcp_range(T * plcp, size_t p, size_t n)
+{
+	// Value is at least one less than preceding value
+	const size_t pn = std::min(p+n, len-1);
+	for (size_t i = p+1 ; i < pn ; ++i) 
+		if (plcp[i] + 1 < plcp[i-1])
+			plcp[i] = plcp[i-1] - 1;
+}
+
+template <typename T>
+void tupla::suffixsort<T>::plcp_carries(const T * plcp, size_t chunk,
+		size_t * carry)
+{
+	// Final value before range is the larger of filled value and value
+	// carried through preceding range
+	carry[0] = 0;
+	for (size_t j = 1 ; (j * chunk) < len ; ++j) {
+		const size_t c = (carry[j-1] > chunk ? carry[j-1] - chunk : 0);
+		carry[j] = std::max((size_t)plcp[ (j * chunk) - 1 ], c);
+	}
+}
+
+template <typename T>
+void tupla::suffixsort<T>::carry_plcp_range(T * plcp, const size_t * carry,
+		size_t p, size_t n, uint32 j)
+{
+	// Stop at first value not less than carried value
+	const size_t pn = std::min(p+n, len-1);
+	size_t c = carry[j];
+	for (size_t i = p ; i < pn && plcp[i] + 1 < c ; ++i)
+		plcp[i] = --c;
+}
+
+template <typename T>
+void tupla::suffixsort<T>::permute_lcp_range(const T * plcp, size_t p,
+		size_t n)
+{
+	for (size_t i = p ; i < p+n ; ++i)
+		lcp[i] = plcp[ sa[i] ];
+}
+
+template <typename T>
+void tupla::suffixsort<T>::count_range(size_t p, size_t n, size_t * range_count, 
 		uint32 j)
 {
-	uint32 * task_count = (range_count + (j * Alpha));
-	for (size_t i = p ; i < p+n ; ++i) 
-		++task_count[  (uint8)*(text + i) ];
+	count_bytes((const uint8 *)(text + p), n, (range_count + (j * Alpha)));
 }
 
-const uint32 tupla::suffixsort::build_prefix(uint32 * count, 
-	uint32 * range_count, uint32 * group, uint8 * sorted, uint32 jobs)
+template <typename T>
+const uint32 tupla::suffixsort<T>::build_prefix(size_t * count, 
+	size_t * range_count, size_t * group, uint8 * sorted, uint32 jobs)
 {
 	uint32 alphasize = 0;
 
 	// Assign initial sorting groups and build prefix sums
-	uint32 f = 0; // First index in group
+	size_t f = 0; // First index in group
 	for (size_t i = 0 ; i < Alpha ; ++i) {
-		uint32 n = count[i];
-		uint32 tn = range_count[i]; // Count in thread range of text
-		uint32 g = f + n - 1; // Last position in group f..g
+		size_t n = count[i];
+		size_t tn = range_count[i]; // Count in thread range of text
+		size_t g = f + n - 1; // Last position in group f..g
 
 		group[i] = g; // Assign group sorting key to last index in f..g
 		groups += sorted[i] = (n == 1); // Singleton group is sorted
@@ -161,7 +598,7 @@ const uint32 tupla::suffixsort::build_prefix(uint32 * count,
 		// Prefix sum starts from f for first and f+tn for following threads
 		range_count[i] = f; 
 		for (size_t j = 1 ; j < jobs ; ++j) {
-			uint32 tin = range_count[(j * Alpha) + i];
+			size_t tin = range_count[(j * Alpha) + i];
 			range_count[(j * Alpha) + i] = f + tn;
 			tn += tin;
 		}
@@ -173,14 +610,15 @@ const uint32 tupla::suffixsort::build_prefix(uint32 * count,
 	return alphasize;
 }
 
-void tupla::suffixsort::sort_range(uint32 p, uint32 n, uint32 * range_count,
-		uint32 * group, uint8 * sorted, uint32 j)
+template <typename T>
+void tupla::suffixsort<T>::sort_range(size_t p, size_t n, size_t * range_count,
+		size_t * group, uint8 * sorted, uint32 j)
 {
-	uint32 * task_count = (range_count + (j * Alpha));
+	size_t * task_count = (range_count + (j * Alpha));
 
 	for (size_t i = p ; i < p+n ; ++i) {
 		uint8 c = (uint8)*(text + i);
-		uint32 j = task_count[c]++;
+		size_t j = task_count[c]++;
 		// Initialize suffix array with counting sort 
 		sa[j] = i;
 		// Initialize inverse suffix array with group sorting key
@@ -190,25 +628,29 @@ void tupla::suffixsort::sort_range(uint32 p, uint32 n, uint32 * range_count,
 	}
 }
 
-void tupla::suffixsort::invert_range(uint32 p, uint32 n)
+template <typename T>
+void tupla::suffixsort<T>::invert_range(size_t p, size_t n)
 {
 	for (size_t i = p ; i<p+n ; ++i)
 		sa[ isa[i] ] = i;
 }
 
-const uint32 * const tupla::suffixsort::get_sa()
+template <typename T>
+const T * const tupla::suffixsort<T>::get_sa()
 {
 	return (finished_sa ? sa : 0);
 }
 
-const uint32 * const tupla::suffixsort::get_lcp()
+template <typename T>
+const T * const tupla::suffixsort<T>::get_lcp()
 {
 	return (finished_lcp ? lcp : 0);
 }
 
-bool tupla::suffixsort::out_descending()
+template <typename T>
+bool tupla::suffixsort<T>::out_descending()
 {
-	uint32 descending = 0;
+	size_t descending = 0;
 	for (size_t i = 1 ; i<len ; ++i) {
 		if (strcmp((text+sa[i]), (text + sa[i-1])) < 0) {
 			std::string a( (text + sa[i]) );
@@ -229,9 +671,10 @@ bool tupla::suffixsort::out_descending()
 	return (descending > 0);
 }
 
-bool tupla::suffixsort::out_incorrect_lcp()
+template <typename T>
+bool tupla::suffixsort<T>::out_incorrect_lcp()
 {
-	uint32 nomatch = 0;
+	size_t nomatch = 0;
 	for (size_t i = 1 ; i<len ; ++i) {
 		if ( (strncmp((text+sa[i]), (text + sa[i-1]), lcp[i]) != 0)
 					&& *(text + sa[i] + lcp[i] + 1) == 
@@ -255,10 +698,11 @@ bool tupla::suffixsort::out_incorrect_lcp()
 	return (nomatch > 0);
 }
 
-uint32 tupla::suffixsort::count_dupes()
+template <typename T>
+size_t tupla::suffixsort<T>::count_dupes()
 {
-	uint32 * match = new uint32[len]();
-	uint32 dupes  = 0;
+	size_t * match = new size_t[len]();
+	size_t dupes  = 0;
 	for (size_t i = 0 ; i<len ; ++i) {
 		dupes += ( ++match[ sa[i] ] > 1 );
 	}
@@ -266,7 +710,8 @@ uint32 tupla::suffixsort::count_dupes()
 	return dupes;
 }
 
-void tupla::suffixsort::out_sa()
+template <typename T>
+void tupla::suffixsort<T>::out_sa()
 {
 	err << "i       sa[i]   order            suffix" << std::endl;
 	for (size_t i = 0 ; i<len ; ++i)  {
@@ -281,13 +726,15 @@ void tupla::suffixsort::out_sa()
 			std::replace( str.begin(), str.end(), '\n', '#');
 			std::replace( str.begin(), str.end(), '\t', '#');
 			err << std::hex << i << "\t"  << sa[i] << "\t"  
-				<< std::hex << std::setw(16) << std::setfill('0') << k(i) 
-				<< std::dec << " '" << str << "'" << std::endl;
+				<< std::hex << std::setw(16) << std::setfill('0') 
+				<< (isa ? k(i) : 0) << std::dec << " '" << str << "'" 
+				<< std::endl;
 		}
 	}
 }
 
-void tupla::suffixsort::out_lcp()
+template <typename T>
+void tupla::suffixsort<T>::out_lcp()
 {
 	if (!finished_lcp) return;
 	err << "i       sa[i]   order            lcp[i] suffix" << std::endl;
@@ -298,27 +745,32 @@ void tupla::suffixsort::out_lcp()
 		std::replace( str.begin(), str.end(), '\n', '#');
 		std::replace( str.begin(), str.end(), '\t', '#');
 		err << std::hex << i << "\t"  << sa[i] << "\t"  
-			<< std::hex << std::setw(16) << std::setfill('0') << k(i) 
-			<< std::dec << " " << std::setw(6) << std::setfill(' ') << lcp[i] 
+			<< std::hex << std::setw(16) << std::setfill('0') 
+			<< (isa ? k(i) : 0) << std::dec << " " << std::setw(6) << std::setfill(' ') << lcp[i] 
 			<< " '" << str << "'" << std::endl;
 	}
 }
 
-bool tupla::suffixsort::out_validate()
+template <typename T>
+bool tupla::suffixsort<T>::out_validate()
 {
 	if (!finished_sa) {
 		err << SELF << ": suffix array not complete" << std::endl;
 		return false;
 	}
 
-	uint32 dupes = count_dupes();
+	size_t dupes = count_dupes();
 
 	out_descending();
 
-	uint32 nomatch = 0;
+	size_t nomatch = 0;
 	if (finished_lcp) nomatch = out_incorrect_lcp();
 
 	return (dupes == 0 && nomatch == 0);
 }
 
+template class tupla::suffixsort<uint32>;
+template class tupla::suffixsort<uint64>;
+template class tupla::suffixsort<uint40>;
+
 // vim:set ts=4 sts=4 sw=4 noexpandtab:
@@ -13,104 +13,249 @@
  * J. Kärkkäinen, G. Manzini & S.J. Puglisi 2009 
  * Permuted Longest-Common-Prefix Array
  *
+ * Template parameter T is the index type of suffix and LCP arrays.
+ *
  * @author jkataja
  */
 
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
 #include <boost/cstdint.hpp>
 #include <boost/thread/mutex.hpp>
-#ifdef __SSE4_2__
-#include <nmmintrin.h>
-#endif
+#include <boost/thread/tss.hpp>
 
 #include "numdefs.hpp"
-
-// Flags for _mm_cmpistri intrisic in SSE4.2 optimized lcplen:
-// Unsigned bytes source
-// Equal each compare: match a[i] with b[i]
-// Negative polarity gives matching elements
-//
-// Intel SSE4 Programming Reference
-// @see http://software.intel.com/sites/default/files/m/0/3/c/d/4/18187-d9156103.pdf 
-#ifdef __SSE4_2__
-#define LCPLEN_FLAGS (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY )
-#endif
+#include "index.hpp"
+#include "kernels.hpp"
+#include "memory.hpp"
+#include "tupla.hpp"
 
 namespace tupla {
 
+template <typename T = uint32>
 class suffixsort {
 
-	friend class tqsort_task;
-	friend class doubling_task;
-
 private:
 	suffixsort(const suffixsort&);
 	suffixsort& operator=(const suffixsort&);
 
 protected:
-	uint32 * sa;  // Suffixes sorted in lexicographical h-order
-	uint32 * isa; // Sorting h-order of the suffixes
-	uint32 * lcp; // LCP built from completed suffix array
+	// Highest bit of index marks sorted group
+	static const uint64 SortedFlag = index_traits<T>::SortedFlag;
+
+	T * sa;  // Suffixes sorted in lexicographical h-order
+	T * isa; // Sorting h-order of the suffixes
+	T * lcp; // LCP built from completed suffix array
 
 	size_t h; // Current suffix doubling distance
 
-	const char * const text; // Input
-	const uint32 len; // Length of input
-	uint32 groups; // Count of singleton groups
+	const char * text; // Input
+	size_t len; // Length of input
+	size_t groups; // Count of singleton groups
 
 	std::ostream& err; // Error stream
 
+	const sortopts opts; // Tuning options
+
 	bool finished_sa;
 	bool finished_lcp;
 
 	// Constructor called from instance()
-	suffixsort(const char * text, const uint32 len, std::ostream& err);
+	suffixsort(const char * text, const size_t len, std::ostream& err,
+			const sortopts& opts);
 
 	// Allocate and initialize suffix array and inverse suffix array
 	// Sort first round using counting sort on first character
 	virtual uint32 init() = 0;
 
-	// Doubling step
+	// Range p..p+n-1 of suffix array containing unsorted groups
+	struct interval {
+		size_t p;
+		size_t n;
+	};
+
+	// Intervals covering all unsorted groups in suffix array order
+	// Doubling rounds only walk these ranges
+	std::vector<interval> unsorted;
+
+	// Add unsorted group p..p+n-1 to end of interval list, joining it to
+	// last interval when sorted run between them is short
+	static inline void add_unsorted(std::vector<interval>& list,
+			size_t p, size_t n)
+	{
+		if (!list.empty() && p - (list.back().p + list.back().n) < IntervalGap)
+			list.back().n = (p + n) - list.back().p;
+		else
+			list.push_back( interval{ p, n } );
+	}
+
+	// Flags for allocating index arrays
+	inline uint32 alloc_flags() const
+	{
+		return ((opts.interleave ? AllocInterleave : 0)
+				| (opts.hugepages ? AllocHugePages : 0)
+				| (opts.pooled ? AllocPooled : 0));
+	}
+
+	// Flags for allocating work arrays, which are taken from buffer pool
+	// of sorter when pooled so that sorting another text reuses them
+	inline uint32 work_flags() const
+	{
+		return (opts.pooled ? AllocPooled : 0);
+	}
+
+	// Report pages backing array when huge pages were requested
+	void report_pages(const char *, const void *);
+
+	// Tasks scheduled by sorter so far, for statistics
+	virtual size_t tasks_scheduled() { return 0; }
+
+	// Count groups by bit length of their size, singletons first
+	std::vector<size_t> group_sizes();
+
+	// Process writing last checkpoint, 0 if none
+	int checkpoint_pid;
+
+	// Hash of input saved in checkpoint, 0 until computed
+	uint64 checkpoint_hash;
+
+	// Hash of input identifying it in checkpoint
+	uint64 input_hash();
+
+	// Write sorting state after doubling round to checkpoint file from a
+	// forked copy of the process, so the next round runs while it is written
+	void checkpoint();
+
+	// Wait for checkpoint being written, false if writing it failed
+	bool wait_checkpoint();
+
+	// Wait for checkpoint being written before a round that would copy
+	// more than 1/CheckpointCopy of suffix array in pages it changes
+	void limit_checkpoint();
+
+	// Restore sorting state from checkpoint file, false if there is none
+	bool restore();
+
+	// Bring state not saved in checkpoint up to date after restore
+	virtual void restored() { }
+
+	// Doubling step, range adds groups which may remain unsorted to list
 	virtual void doubling() = 0;
-	virtual void doubling_range(uint32, size_t) = 0;
+	virtual void doubling_range(size_t, size_t, std::vector<interval>&) = 0;
 
-	// Longest common prefix for range
-	void lcp_range(uint32 p, uint32 n);
+	// Range function fun(p, n, j) for range j of input
+	typedef std::function<void (size_t, size_t, uint32)> range_fun;
+
+	// Length of ranges the LCP array is built in, whole input if sequential
+	virtual size_t lcp_chunk() { return len; }
+
+	// Invoke function for each range of length lcp_chunk() in input
+	virtual void run_chunks(const range_fun& fun) { fun(0, len, 0); }
+
+	// Irreducible permuted longest common prefix values for suffixes in
+	// range of suffix array, reducible values are set to zero
+	void irreducible_range(T * plcp, size_t p, size_t n);
+
+	// Fill reducible PLCP values in range from preceding value in range
+	void fill_plcp_range(T * plcp, size_t p, size_t n);
+
+	// Values carried to start of each range of PLCP from preceding ranges
+	// filled separately, ranges are of length chunk
+	void plcp_carries(const T * plcp, size_t chunk, size_t * carry);
+
+	// Fill reducible PLCP values at start of range j from carried value
+	void carry_plcp_range(T * plcp, const size_t * carry, size_t p, size_t n,
+			uint32 j);
+
+	// Longest common prefix in suffix array order for range from PLCP
+	void permute_lcp_range(const T * plcp, size_t p, size_t n);
 
 	// Character count for range
-	void count_range(uint32, uint32, uint32 *, uint32);
+	void count_range(size_t, size_t, size_t *, uint32);
 
 	// Build prefix sums for counting sort
-	const uint32 build_prefix(uint32 *, uint32 *, uint32 *, uint8 *, uint32);
+	const uint32 build_prefix(size_t *, size_t *, size_t *, uint8 *, uint32);
 
 	// Counting sort for range
-	void sort_range(uint32, uint32, uint32 *, uint32 *, uint8 *, uint32);
+	void sort_range(size_t, size_t, size_t *, size_t *, uint8 *, uint32);
 
 	// Reconstruct suffix array from inverse suffix array
-	void invert_range(uint32, uint32);
+	void invert_range(size_t, size_t);
 
 	// Reconstruct suffix array from inverse suffix array
 	virtual void invert() = 0;
 
 	// Debugging and testing
 	bool out_descending();
-	uint32 count_dupes();
+	size_t count_dupes();
 
 	// Sort range using ternary split quick sort
 	// Based on Bentley-McIlroy 1993: Engineering a Sort Function
-	virtual uint32 tqsort(uint32, size_t);
+	virtual size_t tqsort(size_t, size_t);
+
+	// Doubling key and suffix gathered for sorting in contiguous memory
+	struct keyed {
+		T key;
+		T pos;
+	};
+
+	// Gather buffer of each sorting thread
+	boost::thread_specific_ptr< std::vector<keyed> > keyed_buffer;
+
+	// Gather doubling keys of range to buffer of calling thread
+	keyed * kv_gather(size_t p, size_t n);
+
+	// Sort range on doubling keys gathered to contiguous buffer, then
+	// scatter suffixes back and renumber groups with assign function
+	// Returns the count of new singleton groups
+	template <class A>
+	size_t kvsort(size_t p, size_t n, A assign_group)
+	{
+		keyed * kv = kv_gather(p, n);
+
+		kv_tqsort(kv, n);
+
+		size_t ns = 0;
+		for (size_t a = 0, b = 0 ; a < n ; a = b) {
+			const size_t key = kv[a].key;
+			for ( ; b < n && kv[b].key == key ; ++b)
+				sa[p+b] = kv[b].pos;
+
+			assign_group(p+a, b-a);
+			ns += (b - a == 1);
+		}
+
+		return ns;
+	}
+
+	// Ternary split quick sort on gathered keys
+	void kv_tqsort(keyed *, size_t);
+
+	// Median of three gathered keys, returns index to it
+	inline size_t kv_med3(const keyed * kv, const size_t a, const size_t b,
+			const size_t c)
+	__attribute__((always_inline))
+	{
+		const size_t ka = kv[a].key;
+		const size_t kb = kv[b].key;
+		const size_t kc = kv[c].key;
+		return (ka < kb ? (kb < kc ? b : (ka < kc ? c : a) )
+		                : (kb > kc ? b : (ka < kc ? a : c) ) ); 
+	}
 
 	// Determine median value of three suffix array elements
 	// Returns index to position where median was found
 	// Based on Bentley-McIlroy 1993: Engineering a Sort Function
-	inline uint32 med3(const uint32 a, const uint32 b, const uint32 c)
+	inline size_t med3(const size_t a, const size_t b, const size_t c)
 	 __attribute__((always_inline))
 	{
-		const uint64 ka = k(a);
-		const uint64 kb = k(b);
-		const uint64 kc = k(c);
+		const size_t ka = k(a);
+		const size_t kb = k(b);
+		const size_t kc = k(c);
 		// abc acb cab
 		// cba bac bca
 		return (ka < kb ? (kb < kc ? b : (ka < kc ? c : a) )
@@ -118,15 +263,15 @@ protected:
 	}
 
 	// Choose pivot value from n elements starting at p using pseudomedian
-	// Returns value ( ISA_h[ SA_h[pivot] ] , ISA_h[ SA_h[pivot] + h ] ) 
+	// Returns value ISA_h[ SA_h[pivot] + h ]
 	// Based on Bentley-McIlroy 1993: Engineering a Sort Function
-	inline uint64 choose_pivot(uint32 p, size_t n)
+	inline size_t choose_pivot(size_t p, size_t n)
 	{
-		uint32 a = p;
-		uint32 b = p + (n/2);
-		uint32 c = p + n - 1;
+		size_t a = p;
+		size_t b = p + (n/2);
+		size_t c = p + n - 1;
 		if (n > 40) { // Big arrays, pseudomedian of 9
-			uint32 s = (n/8);
+			size_t s = (n/8);
 			a = med3( a, a+s, a+2*s );
 			b = med3( b-s, b, b+s );
 			c = med3( c-2*s, c-s, c );
@@ -137,52 +282,34 @@ protected:
 	}
 
 	// Comparison key for index p in suffix array
-	// Returns pair ( ISA_h[ SA_h[p] ] , ISA_h[ SA_h[p] + h ] ) packed in long
-	inline uint64 k(const uint32 p) 
+	// Returns ISA_h[ SA_h[p] + h ], assuming ISA_h[ SA_h[p] ] is equal
+	// in the sorted group
+	inline size_t k(const size_t p)
 	__attribute__((always_inline))
 	{
-		uint32 v = sa[p];
+		const size_t v = sa[p];
 
-		return (v + h < len 
-				? (((uint64)isa[ v ] << 32) | isa[ v + h ] )
-				:  ((uint64)isa[ v ] << 32) ); 
+		return (v + h < len ? (size_t)isa[ v + h ] : 0);
 	}
 
 	// Find longest common prefix of positions a and b in text.
-	// SSE4.2 version uses _mm_cmpistri intrisic to compare 16 characters 
-	// at a time, matching also nulls (if a==b until segfault)
-	inline uint32 lcplen(const uint32 a, const uint32 b)
+	// Compares whole vectors with kernel selected for processor
+	inline size_t lcplen(const size_t a, const size_t b)
 	__attribute__((always_inline))
 	{
-		const char * pa = (text + a);
-		const char * pb = (text + b);
-#ifdef __SSE4_2__
-		uint32 l = 1;
-		uint32 n;
-		if (*pa++ != *pb++) return 0;
-		__m128i xa, xb;
-		do {
-			xa = _mm_loadu_si128((__m128i *)pa);
-			xb = _mm_loadu_si128((__m128i *)pb);
-		} while ( ((n = _mm_cmpistri(xa, xb, LCPLEN_FLAGS)) == 16) 
-				&& (l += n) && (pa += 16) && (pb += 16) );
-		return l + n;
-#else
-		uint32 l = 0;
-		while (*pa++ == *pb++) ++l;
-		return l;
-#endif
+		if (text[a] != text[b]) return 0;
+		return lcplen_kernel(text + a, text + b);
 	}
 
 	// Swap suffix array elements at indices
-	inline void swap(const uint32& a, const uint32& b)
+	inline void swap(const size_t a, const size_t b)
 	__attribute__((always_inline))
 	{
 		std::swap( sa[a], sa[b] );
 	}
 
 	// Swap n suffix array elements starting from indices a and b
-	inline void vecswap(uint32 a, uint32 b, size_t n)
+	inline void vecswap(size_t a, size_t b, size_t n)
 	__attribute__((always_inline))
 	{
 		for ( ; n ; --n) swap(a++, b++);
@@ -190,10 +317,10 @@ protected:
 
 	// Renumber group at p..g with matching sorting key as g 
 	// Group number is last index with value to keep sort keys decreasing
-	inline void assign(uint32 p, size_t n)
+	inline void assign(size_t p, size_t n)
 	__attribute__((always_inline))
 	{
-		uint32 g = p + n - 1;
+		size_t g = p + n - 1;
 
 		for (size_t i = p ; i < p+n ; ++i) 
 			isa[ sa[i] ] = g;
@@ -202,35 +329,35 @@ protected:
 
 	}
 
-	// First byte set in suffix array sets sorted flag
-	inline void set_sorted(uint32 p, uint32 n)
+	// First bit set in suffix array sets sorted flag
+	inline void set_sorted(size_t p, size_t n)
 	__attribute__((always_inline))
 	{
-		sa[p] = (0x80000000U ^ n);
+		sa[p] = (SortedFlag ^ n);
 	}
 
 	// Length of sorted group starting from p
-	inline uint32 get_sorted(uint32 p)
+	inline size_t get_sorted(size_t p)
 	__attribute__((always_inline))
 	{
-		uint32 v = sa[p];
-		return ((v >> 31) ? (0x7FFFFFFFU & v) : 0); 
+		const uint64 v = sa[p];
+		return ((v & SortedFlag) ? ((SortedFlag - 1) & v) : 0);
 	}
 
 	// Sort small range using variation of selection sort
 	// Based on N. Jesper Larsson & Kunihiko Sadakane: Faster Suffix Sorting
-	inline uint32 sort_small(uint32 p, uint32 n)
+	inline size_t sort_small(size_t p, size_t n)
 	__attribute__((always_inline))
 	{
-		uint32 a = p; // Start of current sorting range and minimum group
-		uint32 b = p; // End of minimum group
-		uint32 d = p+n-1; // End of sorting range
-		uint32 ns = 0; // Count of assigned singleton groups
-		uint32 tv; // Comparison element
+		size_t a = p; // Start of current sorting range and minimum group
+		size_t b = p; // End of minimum group
+		size_t d = p+n-1; // End of sorting range
+		size_t ns = 0; // Count of assigned singleton groups
+		size_t tv; // Comparison element
 
 		while (a < d) {
 			// Move minimum group to range a..b-1
-			for (uint32 i = b = a+1 , min = isa[ sa[a] + h ] ; i <= d ; ++i) {
+			for (size_t i = b = a+1 , min = isa[ sa[a] + h ] ; i <= d ; ++i) {
 				if ((tv = isa[ sa[i] + h ]) < min) {
 					min = tv;
 					swap(i, a);
@@ -256,15 +383,20 @@ protected:
 
 public:
 
-	static suffixsort * instance(const char *, const uint32, const uint32, 
-			std::ostream&);
-	~suffixsort();
+	static suffixsort * instance(const char *, const size_t, const uint32,
+			std::ostream&, const sortopts& = sortopts());
+	virtual ~suffixsort();
+
+	// Prepare to sort new input, keeping threads. Arrays of previous
+	// input are released, to the buffer pool if sorter is pooled
+	virtual void reset(const char *, const size_t);
 
 	// Build Suffix Array
 	virtual void build_sa();
 
 	// Compute Longest Common Prefix array
-	virtual void build_lcp() = 0;
+	// Uses the permuted LCP, building inverse suffix array if missing
+	virtual void build_lcp();
 
 	// Output generated SA
 	virtual void out_sa();
@@ -279,10 +411,10 @@ public:
 	virtual bool out_incorrect_lcp();
 
 	// Access the class internal SA
-	virtual const uint32 * const get_sa();
+	virtual const T * const get_sa();
 
 	// Access the class internal LCP array
-	virtual const uint32 * const get_lcp();
+	virtual const T * const get_lcp();
 
 };
 
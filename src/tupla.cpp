@@ -1,10 +1,16 @@
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <boost/iostreams/device/mapped_file.hpp>
 
 #include "tupla.hpp"
+#include "kernels.hpp"
 
 using namespace tupla;
 
@@ -18,13 +24,13 @@ long tupla::stat_filesize(const std::string& filename)
 	return (rc == 0 ? stat_buf.st_size : -1);
 }
 
-void * tupla::read_byte_string(const std::string& filename, const uint32 len) 
+void * tupla::read_byte_string(const std::string& filename, const size_t len) 
 {
-	if (len == 0) return new char[1]();
+	if (len == 0) return new char[1 + TextPadding]();
 
-	long len_eof = len + 1;
+	size_t len_eof = len + 1;
 
-	if (len > stat_filesize(filename)) {
+	if ((long)len > stat_filesize(filename)) {
 		throw std::runtime_error("attempt to read past input");
 	}
 
@@ -38,19 +44,121 @@ void * tupla::read_byte_string(const std::string& filename, const uint32 len)
 
 	// copy data and pad with terminator
 	char * data = (char * )in.data();
-	char * data_eof = new char[len_eof];
+	char * data_eof = new char[len_eof + TextPadding];
 	if (data_eof == 0) {
 		in.close();
 		throw std::runtime_error("could not allocate enough memory to fit file");
 	}
 	memcpy((void *)data_eof, (void *)data, len);
-	data_eof[len] = 0;
+	memset((void *)(data_eof + len), 0, 1 + TextPadding);
 
 	in.close();
 
 	return data_eof;
 }
 
+void * tupla::read_stream_string(int fd, const size_t maxlen, size_t& len,
+		size_t * count)
+{
+	// Regular files are read to buffer of file size
+	size_t cap = StreamBlock;
+	struct stat stat_buf;
+	if (fstat(fd, &stat_buf) == 0 && S_ISREG(stat_buf.st_mode)) {
+		cap = std::max(cap, std::min(maxlen, (size_t)stat_buf.st_size));
+	}
+	char * data = new char[cap + 1 + TextPadding];
+	len = 0;
+
+	while (len < maxlen) {
+		// Full buffer is grown only if more input follows, so a regular
+		// file is not copied for reading its end
+		char probe[64];
+		const bool full = (len == cap);
+		ssize_t n = (full ? read(fd, probe, std::min(sizeof(probe),
+				(maxlen - len))) : read(fd, (data + len),
+				std::min((cap - len), (maxlen - len))));
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) {
+			delete [] data;
+			throw std::runtime_error("could not read input stream");
+		}
+		if (n == 0) break;
+
+		// Grow buffer to fit next block
+		if (full) {
+			cap *= 2;
+			char * grown = new char[cap + 1 + TextPadding];
+			memcpy((void *)grown, (void *)data, len);
+			memcpy((void *)(grown + len), (void *)probe, n);
+			delete [] data;
+			data = grown;
+		}
+
+		// Count block while writer fills the pipe with next one
+		count_bytes((const uint8 *)(data + len), n, count);
+		len += n;
+	}
+
+	memset((void *)(data + len), 0, 1 + TextPadding);
+	++count[0];
+
+	return data;
+}
+
+// Length of mapping for byte string with terminator and padding
+static size_t mapped_length(const size_t len)
+{
+	const size_t page = sysconf(_SC_PAGESIZE);
+	return ((len + 1 + TextPadding + page - 1) / page) * page;
+}
+
+void * tupla::map_byte_string(const std::string& filename, const size_t len)
+{
+	if ((long)len > stat_filesize(filename)) {
+		throw std::runtime_error("attempt to read past input");
+	}
+
+	// Reserve zero pages for text, terminator and padding
+	const size_t size = mapped_length(len);
+	void * base = mmap(0, size, (PROT_READ | PROT_WRITE), 
+			(MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+	if (base == MAP_FAILED) {
+		throw std::runtime_error("could not map input file");
+	}
+
+	// Map file over start of reserved range, bytes past end of file in 
+	// last page read as zero
+	if (len > 0) {
+		int fd = open(filename.c_str(), O_RDONLY);
+		void * data = MAP_FAILED;
+		if (fd >= 0) {
+			data = mmap(base, len, (PROT_READ | PROT_WRITE),
+					(MAP_PRIVATE | MAP_FIXED), fd, 0);
+			close(fd);
+		}
+		if (data == MAP_FAILED) {
+			munmap(base, size);
+			throw std::runtime_error("could not map input file");
+		}
+	}
+
+	// Terminate, copying last page only if file continues past length
+	char * data_eof = (char *)base;
+	for (size_t i = len ; i <= len + TextPadding ; ++i) {
+		if (data_eof[i] != 0) {
+			memset((void *)(data_eof + i), 0, (len + TextPadding + 1) - i);
+			break;
+		}
+	}
+
+	return data_eof;
+}
+
+void tupla::unmap_byte_string(void * data, const size_t len)
+{
+	munmap(data, mapped_length(len));
+}
+
 void tupla::write_byte_string(const void * const data, const size_t len, 
 		const std::string& filename) 
 {
@@ -68,8 +176,7 @@ void tupla::write_byte_string(const void * const data, const size_t len,
 	}
 
 	if (len > 0) {
-		uint32 * out_data = (uint32 * )out.data();
-		memcpy((void *)out_data, (void *)data, len); 
+		memcpy((void *)out.data(), data, len); 
 	}
 
 	out.close();
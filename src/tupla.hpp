@@ -7,9 +7,11 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <boost/cstdint.hpp>
 
 #include "numdefs.hpp"
+#include "index.hpp"
 
 #define Z16 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 
 #define Z64 Z16,Z16,Z16,Z16
@@ -26,6 +28,17 @@ static const char RankFileSuffix[] = "rank";
 // Output LCP table file suffix 
 static const char LCPFileSuffix[] = "lcp";
 
+// Checkpoint of doubling rounds file suffix
+static const char CheckpointFileSuffix[] = "ckpt";
+
+// Suffix sorting algorithms
+static const char AlgorithmDoubling[] = "doubling";
+static const char AlgorithmInduced[] = "sais";
+
+// Input file name for reading standard input, and name of its output
+static const char StreamInput[] = "-";
+static const char StreamOutput[] = "stdin";
+
 // Letters in alphabet
 static const uint32 Alpha = 256;
 
@@ -33,22 +46,109 @@ static const uint32 Alpha = 256;
 static const uint32 JobsMin = 1;
 static const uint32 JobsMax = 64;
 
-// Maximum input length
-static const size_t MaxInput = 0x7FFFFFFE;
+// Maximum input length with 64-bit indices
+static const size_t MaxInput = index_traits<uint64>::MaxInput;
+
+// Index width choices, automatic uses 32-bit indices for small inputs
+// and packed 40-bit indices for large inputs
+static const uint32 IndexBitsAuto = 0;
+
+// Bytes readable after terminator of input text, so comparisons may load
+// whole vectors past the first differing character
+static const uint32 TextPadding = 64;
 
 // Minimum input length to assign sort to a new thread
 static const uint32 BucketSize = (1 << 18);
 
+// Minimum group length to sort with parallel radix pass
+static const uint32 RadixSize = (1 << 22);
+
+// Bits of doubling key in each radix bucket number
+static const uint32 RadixBits = 11;
+
+// Bytes in each read from input stream
+static const uint32 StreamBlock = (1 << 20);
+
+// Bytes following each block sorted with the block in external sort,
+// suffixes with longer common prefix are sorted by prefix doubling
+static const uint32 ExternalOverlap = (1 << 10);
+
+// Indices in each read and write buffer when merging external blocks
+static const uint32 ExternalBuffer = (1 << 16);
+
+// Open files kept free when merging external blocks and runs
+static const uint32 ExternalFiles = 16;
+
+// Largest input sorted in one thread alongside others in batch mode
+static const uint32 BatchSmall = (1 << 24);
+
+// Minimum sorted run between unsorted groups to skip in doubling rounds
+static const uint32 IntervalGap = (1 << 10);
+
+// Fraction of suffix array that pages copied for a checkpoint being
+// written may take before next doubling round waits for it
+static const uint32 CheckpointCopy = 4;
+
+// Minimum entries in list of new singleton groups of each worker
+static const uint32 PatchMinimum = (1 << 10);
+
+class sortstats;
+
+class buffer_pool;
+
+// Options for suffix sorters
+struct sortopts
+{
+	sortopts() : algorithm(AlgorithmDoubling), gather(false), 
+		text_count(0), resume(false), interleave(false), hugepages(false),
+		pin(false), pooled(false), pool(0), stats(0) { }
+
+	std::string algorithm; // Suffix sorting algorithm
+	bool gather; // Sort doubling keys gathered to contiguous buffer
+	std::string sa_file; // Allocate suffix array mapped to this file
+	std::string lcp_file; // Allocate LCP array mapped to this file
+	const size_t * text_count; // Character counts of text, if known
+	std::string checkpoint; // Save doubling rounds to this file
+	bool resume; // Continue from last round saved in checkpoint
+	bool interleave; // Interleave arrays over memory nodes
+	bool hugepages; // Back arrays with huge pages
+	bool pin; // Pin worker threads to processors
+	bool pooled; // Reuse arrays released by earlier sorters
+	buffer_pool * pool; // Pool of pooled arrays, shared pool if null
+	sortstats * stats; // Record timing and counters of phases
+};
+
 // Get file size
 long stat_filesize(const std::string&);
 
 // Read byte string from file, returns pointer to allocated memory
-// plus one additional byte for null terminator 
-void * read_byte_string(const std::string&, const uint32);
+// plus one additional byte for null terminator and TextPadding zero bytes
+void * read_byte_string(const std::string&, const size_t);
+
+// Read byte string from file descriptor until end of input or maxlen
+// bytes, into buffer grown as needed. Sets len to bytes read and adds
+// character counts of text with terminator to count. Buffer has null
+// terminator and TextPadding zero bytes as from read_byte_string()
+void * read_stream_string(int, const size_t, size_t&, size_t *);
+
+// Map byte string from file privately without copying, followed by null
+// terminator and TextPadding zero bytes. Release with unmap_byte_string()
+void * map_byte_string(const std::string&, const size_t);
+
+// Release mapping of byte string of length len
+void unmap_byte_string(void *, const size_t);
 
 // Write byte string to file
 void write_byte_string(const void * const, const size_t, const std::string&);
 
+// Write array of n indices to file
+template <typename T>
+void write_index_array(const T * const data, const size_t n,
+		const std::string& filename)
+{
+	write_byte_string(data, (n * sizeof(T)), filename);
+}
+
 } // namespace
 
 // vim:set ts=4 sts=4 sw=4 noexpandtab:
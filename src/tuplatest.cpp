@@ -3,10 +3,21 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <cstdio>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/stat.h>
 #include <cstring>
+#include <sstream>
 
 #include "tupla.hpp"
 #include "suffixsort.hpp"
+#include "scheduler.hpp"
+#include "kernels.hpp"
+#include "extsort.hpp"
+#include "batch.hpp"
+#include "stats.hpp"
+#include "libtupla.hpp"
+#include "libtupla.h"
 
 using namespace tupla;
 
@@ -19,22 +30,25 @@ std::vector<std::string> test_files = {
 
 
 // First element in suffix array is terminator
-bool has_sa_terminator(const uint32 * const sa, uint32 len)
+template <typename T>
+bool has_sa_terminator(const T * const sa, size_t len)
 {
 	return ( sa[0] == len-1 );
 }
 
 // Suffix array contents for a and b are equal 
-bool has_sa_equal(const uint32 * const a, const uint32 * const b, 
-		const uint32 len)
+template <typename T>
+bool has_sa_equal(const T * const a, const T * const b, 
+		const size_t len)
 {
-	return ( memcmp(a, b, sizeof(uint32) * len) == 0 );
+	return ( memcmp(a, b, sizeof(T) * len) == 0 );
 }
 
 // All indices in suffix array are under text length
-bool has_sa_range(const uint32 * const sa, const uint32 len)
+template <typename T>
+bool has_sa_range(const T * const sa, const size_t len)
 {
-	for (uint32 i = 0 ; i<len ; ++i) {
+	for (size_t i = 0 ; i<len ; ++i) {
 		if (sa[i] >= len)
 			return false;
 	}
@@ -42,10 +56,11 @@ bool has_sa_range(const uint32 * const sa, const uint32 len)
 }
 
 // All indices in suffix array are unique
-bool has_sa_unique(const uint32 * const sa, uint32 len)
+template <typename T>
+bool has_sa_unique(const T * const sa, size_t len)
 {
 	uint32 * match = new uint32[len]();
-	uint32 dupes  = 0;
+	size_t dupes  = 0;
 	for (size_t i = 0 ; i<len ; ++i) {
 		dupes += ( ++match[ sa[i] ] > 1 );
 	}
@@ -54,7 +69,8 @@ bool has_sa_unique(const uint32 * const sa, uint32 len)
 }
 
 // Suffixes in ascending order
-bool is_ascending(const uint32 * const sa, const char * text, uint32 len)
+template <typename T>
+bool is_ascending(const T * const sa, const char * text, size_t len)
 {
 	for (size_t i = 1 ; i<len ; ++i) {
 		if (memcmp((text+sa[i]), (text + sa[i-1]), len-sa[i]) < 0) {
@@ -66,8 +82,9 @@ bool is_ascending(const uint32 * const sa, const char * text, uint32 len)
 }
 
 // Common prefix part matches and first character after is different
-bool has_correct_lcp(const uint32 * const sa, const uint32 * const lcp, 
-		const char * text, uint32 len)
+template <typename T>
+bool has_correct_lcp(const T * const sa, const T * const lcp, 
+		const char * text, size_t len)
 {
 	for (size_t i = 1 ; i<len ; ++i) {
 		if (memcmp((text+sa[i]), (text + sa[i-1]), lcp[i]) != 0) {
@@ -78,24 +95,43 @@ bool has_correct_lcp(const uint32 * const sa, const uint32 * const lcp,
 	return true;
 }
 
+// Add range length to total, splitting long ranges to new tasks
+scheduler * test_sched;
+void count_task(void * obj, size_t p, size_t n)
+{
+	if (n > 1) {
+		test_sched->schedule(&count_task, obj, p, n/2);
+		test_sched->schedule(&count_task, obj, p + n/2, n - n/2);
+		return;
+	}
+	__atomic_fetch_add((size_t *)obj, n, __ATOMIC_RELAXED);
+}
+
 // Run suffix sorting for input and compare result to expected
+template <typename T = uint32>
 void run_sorter(std::string& in_name, uint32 jobs, 
-		const uint32 cap = 0x7FFFFFFE)
+		const size_t cap = index_traits<T>::MaxInput, 
+		const std::string& algorithm = AlgorithmDoubling,
+		const bool gather = false)
 {
+	sortopts opts;
+	opts.algorithm = algorithm;
+	opts.gather = gather;
+
 	long in_filesize = stat_filesize(in_name);
 	BOOST_CHECK( in_filesize != -1 );
 
-	uint32 len = (uint32)in_filesize;
+	size_t len = (size_t)in_filesize;
 	len = std::min(len, cap);
-	uint32 len_eof = len + 1;
+	size_t len_eof = len + 1;
 	char * text_eof = (char *)read_byte_string(in_name, len);
 
-	std::unique_ptr<suffixsort> sorter( suffixsort::instance( text_eof,
-			len_eof, jobs, std::cerr) );
+	std::unique_ptr< suffixsort<T> > sorter( suffixsort<T>::instance(
+			text_eof, len_eof, jobs, std::cerr, opts) );
 
 	sorter->build_sa();
 
-	const uint32 * const sa = sorter->get_sa();
+	const T * const sa = sorter->get_sa();
 
 	BOOST_CHECK( has_sa_range(sa, len_eof) );
 	BOOST_CHECK( has_sa_unique(sa, len_eof) );
@@ -104,7 +140,7 @@ void run_sorter(std::string& in_name, uint32 jobs,
 
 	sorter->build_lcp();
 	
-	const uint32 * const lcp = sorter->get_lcp();
+	const T * const lcp = sorter->get_lcp();
 	
 	BOOST_CHECK( has_correct_lcp(sa, lcp, text_eof, len_eof) );
 
@@ -121,6 +157,30 @@ BOOST_AUTO_TEST_CASE( read_text )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( read_stream ) 
+{
+	// banana through pipe, with and without limit
+	for (size_t maxlen = 4 ; maxlen <= 8 ; maxlen += 4) {
+		int fd[2];
+		BOOST_REQUIRE( pipe(fd) == 0 );
+		BOOST_REQUIRE( write(fd[1], "banana", 6) == 6 );
+		close(fd[1]);
+
+		size_t len = 0;
+		size_t count[Alpha] = { Z256 };
+		char * text = (char *)read_stream_string(fd[0], maxlen, len, count);
+		close(fd[0]);
+
+		BOOST_CHECK( len == std::min(maxlen, (size_t)6) );
+		BOOST_CHECK( strncmp("banana", text, len) == 0 );
+		for (size_t i = len ; i <= len + TextPadding ; ++i)
+			BOOST_CHECK( text[i] == 0 );
+		BOOST_CHECK( count[0] == 1 && count['b'] == 1 );
+		BOOST_CHECK( count['a'] == (len / 2) && count['n'] == (len - 1) / 2 );
+		delete [] text;
+	}
+}
+
 BOOST_AUTO_TEST_CASE( write_binary ) 
 {
 	// test/cafebabe
@@ -130,6 +190,17 @@ BOOST_AUTO_TEST_CASE( write_binary )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( packed_index ) 
+{
+	BOOST_CHECK( sizeof(uint40) == 5 );
+	uint40 v[2] = { 0xFFFFFFFFFFULL, 0 };
+	BOOST_CHECK( (uint64)v[0] == 0xFFFFFFFFFFULL );
+	++v[1]; v[0] += 1;
+	BOOST_CHECK( v[0] == 0 && v[1] == 1 );
+	v[1] = 0x100000000ULL;
+	BOOST_CHECK( --v[1] == 0xFFFFFFFFULL );
+}
+
 BOOST_AUTO_TEST_CASE( read_binary ) 
 {
 	// test/cafebabe
@@ -140,6 +211,477 @@ BOOST_AUTO_TEST_CASE( read_binary )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( lcplen_versions ) 
+{
+	// Strings differing at each offset, up to end of padded text
+	const size_t n = 300;
+	char a[n + TextPadding] = { 0 };
+	char b[n + TextPadding] = { 0 };
+	for (size_t i = 0 ; i < n ; ++i)
+		a[i] = b[i] = 'a' + (i % 7);
+
+	for (int level = SimdGeneric ; level <= simd_supported() ; ++level) {
+		lcplen_fun lcplen = lcplen_version((simd_level)level);
+		for (size_t d = 0 ; d < n ; ++d) {
+			b[d] = 'z';
+			for (size_t p = 0 ; p <= d ; p += 13)
+				BOOST_CHECK( lcplen(a + p, b + p) == d - p );
+			b[d] = a[d];
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( gather_versions ) 
+{
+	const size_t n = 77;
+	uint32 isa[n + 3];
+	uint32 sa[n];
+	for (size_t i = 0 ; i < n + 3 ; ++i)
+		isa[i] = (i * 2654435761u) % 1000;
+	for (size_t i = 0 ; i < n ; ++i)
+		sa[i] = (i * 31) % n;
+
+	for (int level = SimdGeneric ; level <= simd_supported() ; ++level) {
+		for (size_t m = 0 ; m <= n - 3 ; m += 7) {
+			uint32 out[2*n];
+			gather_version((simd_level)level)(isa + 3, sa, m, out);
+			size_t lo = ~(size_t)0, hi = 0;
+			bounds_version((simd_level)level)(isa + 3, sa, m, &lo, &hi);
+			size_t min = ~(size_t)0, max = 0;
+			for (size_t i = 0 ; i < m ; ++i) {
+				BOOST_CHECK( out[2*i] == isa[ sa[i] + 3 ] );
+				BOOST_CHECK( out[2*i + 1] == sa[i] );
+				min = std::min(min, (size_t)out[2*i]);
+				max = std::max(max, (size_t)out[2*i]);
+			}
+			BOOST_CHECK( lo == min && hi == max );
+		}
+	}
+
+	size_t count[256] = { 0 };
+	count_bytes((const uint8 *)"abracadabra", 11, count);
+	BOOST_CHECK( count['a'] == 5 && count['b'] == 2 && count['r'] == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( radix_groups ) 
+{
+	// Mostly 'a' with other characters mixed in, so that group of first
+	// character exceeds RadixSize
+	const size_t len = RadixSize + (RadixSize >> 3);
+	std::vector<char> text_eof(len + TextPadding, 0);
+	uint32 x = 12345;
+	for (size_t i = 0 ; i < len - 1 ; ++i) {
+		x = (x * 1103515245u) + 12345u;
+		const uint32 r = ((x >> 16) & 0xff);
+		text_eof[i] = (r >= 16 ? 'a' : 'b' + r);
+	}
+
+	sortopts opts;
+	std::unique_ptr< suffixsort<uint32> > seq( 
+			suffixsort<uint32>::instance(text_eof.data(), len, 1, std::cerr, opts) );
+	seq->build_sa();
+	for (uint32 jobs = 2 ; jobs <= 4 ; jobs += 2) {
+		std::unique_ptr< suffixsort<uint32> > par( 
+				suffixsort<uint32>::instance(text_eof.data(), len, jobs, std::cerr, opts) );
+		par->build_sa();
+		BOOST_CHECK( has_sa_equal(par->get_sa(), seq->get_sa(), len) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( map_binary ) 
+{
+	// test/cafebabe
+	for (size_t len = 2 ; len <= 4 ; len += 2) {
+		char * data = (char *)map_byte_string("test/cafebabe", len);
+		BOOST_CHECK( memcmp(data, "\xBE\xBA", 2) == 0 );
+		for (size_t i = len ; i <= len + TextPadding ; ++i)
+			BOOST_CHECK( data[i] == 0 );
+		unmap_byte_string(data, len);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( direct_output ) 
+{
+	// test/banana.rank
+	{
+		sortopts opts;
+		opts.sa_file = "test/banana.rank";
+		char * text_eof = (char *)read_byte_string("data/trivial/banana", 6);
+		{
+			std::unique_ptr< suffixsort<uint32> > sorter( 
+					suffixsort<uint32>::instance(text_eof, 7, 1, std::cerr, opts) );
+			sorter->build_sa();
+		}
+		delete [] text_eof;
+
+		BOOST_CHECK( stat_filesize(opts.sa_file) == 7 * sizeof(uint32) );
+		uint32 * sa = (uint32 *)read_byte_string(opts.sa_file, 7 * sizeof(uint32));
+		const uint32 expected[7] = { 6, 5, 3, 1, 0, 4, 2 };
+		BOOST_CHECK( has_sa_equal(sa, expected, 7) );
+		delete [] sa;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( external_blocks ) 
+{
+	// Fibonacci string, with repeats longer than overlap between blocks
+	std::string a("a"), b("ab");
+	while (b.size() < 20000) {
+		std::string c = b + a;
+		a.swap(b);
+		b.swap(c);
+	}
+	size_t len_eof = b.size() + 1;
+	char * text_eof = new char[len_eof + TextPadding]();
+	memcpy(text_eof, b.data(), b.size());
+
+	std::unique_ptr< suffixsort<uint32> > sorter( suffixsort<uint32>::instance(
+			text_eof, len_eof, 1, std::cerr) );
+	sorter->build_sa();
+
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		extsort<uint32> ext(text_eof, len_eof, jobs, std::cerr, sortopts(),
+				(1000 * (1 + (5 * sizeof(uint32)))), 16);
+		ext.build_sa("test/fib.rank", "test/fib.rank");
+
+		BOOST_CHECK( stat_filesize("test/fib.rank") 
+				== (long)(len_eof * sizeof(uint32)) );
+		uint32 * sa = (uint32 *)read_byte_string("test/fib.rank",
+				len_eof * sizeof(uint32));
+		BOOST_CHECK( has_sa_equal(sa, sorter->get_sa(), len_eof) );
+		delete [] sa;
+	}
+
+	delete [] text_eof;
+}
+
+BOOST_AUTO_TEST_CASE( external_long_run )
+{
+	// Run of 768 KiB between random text and its repeat, so that suffixes
+	// in run form groups across all blocks
+	const size_t run = (768 << 10);
+	std::string r;
+	uint32 x = 1;
+	for (size_t i = 0 ; i < (64 << 10) ; ++i) {
+		x = x * 1103515245u + 12345u;
+		r.push_back( 'b' + ((x >> 16) & 0x3) );
+	}
+	std::string s = r + std::string(run, 'a') + r + std::string(run / 2, 'a');
+	size_t len_eof = s.size() + 1;
+	char * text_eof = new char[len_eof + TextPadding]();
+	memcpy(text_eof, s.data(), s.size());
+
+	std::unique_ptr< suffixsort<uint32> > sorter( suffixsort<uint32>::instance(
+			text_eof, len_eof, 1, std::cerr) );
+	sorter->build_sa();
+
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		extsort<uint32> ext(text_eof, len_eof, jobs, std::cerr, sortopts(),
+				(4 << 20));
+		ext.build_sa("test/run.rank", "test/run.rank");
+
+		BOOST_CHECK( stat_filesize("test/run.rank")
+				== (long)(len_eof * sizeof(uint32)) );
+		uint32 * sa = (uint32 *)read_byte_string("test/run.rank",
+				len_eof * sizeof(uint32));
+		BOOST_CHECK( has_sa_equal(sa, sorter->get_sa(), len_eof) );
+		delete [] sa;
+	}
+
+	delete [] text_eof;
+}
+
+BOOST_AUTO_TEST_CASE( external_merge_passes )
+{
+	// Blocks of 1 MiB limit are merged two files at a time, so several
+	// passes run before output. Repeats form groups sorted after merge
+	std::string r;
+	uint32 x = 7;
+	for (size_t i = 0 ; i < (64 << 10) ; ++i) {
+		x = x * 1103515245u + 12345u;
+		r.push_back( 'a' + ((x >> 16) & 0x7) );
+	}
+	std::string s = r + r + r + r + r;
+	size_t len_eof = s.size() + 1;
+	char * text_eof = new char[len_eof + TextPadding]();
+	memcpy(text_eof, s.data(), s.size());
+
+	std::unique_ptr< suffixsort<uint32> > sorter( suffixsort<uint32>::instance(
+			text_eof, len_eof, 1, std::cerr) );
+	sorter->build_sa();
+
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		std::ostringstream err;
+		extsort<uint32> ext(text_eof, len_eof, jobs, err, sortopts(),
+				(1 << 20));
+		ext.build_sa("test/passes.rank", "test/passes.rank");
+		BOOST_CHECK( err.str().find("in pass 2") != std::string::npos );
+
+		BOOST_CHECK( stat_filesize("test/passes.rank")
+				== (long)(len_eof * sizeof(uint32)) );
+		uint32 * sa = (uint32 *)read_byte_string("test/passes.rank",
+				len_eof * sizeof(uint32));
+		BOOST_CHECK( has_sa_equal(sa, sorter->get_sa(), len_eof) );
+		delete [] sa;
+	}
+
+	delete [] text_eof;
+}
+
+BOOST_AUTO_TEST_CASE( checkpoint_resume )
+{
+	// test/abracadabra.ckpt
+	const char text_eof[12 + TextPadding] = "abracadabra";
+	const uint32 expected[12] = { 11, 10, 7, 0, 3, 5, 8, 1, 4, 6, 9, 2 };
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		sortopts opts;
+		opts.checkpoint = "test/abracadabra.ckpt";
+		{
+			std::unique_ptr< suffixsort<uint32> > sorter( 
+					suffixsort<uint32>::instance(text_eof, 12, jobs, std::cerr, opts) );
+			sorter->build_sa();
+		}
+		BOOST_CHECK( stat_filesize(opts.checkpoint) > 0 );
+
+		// Resume from last saved round
+		opts.resume = true;
+		std::unique_ptr< suffixsort<uint32> > sorter( 
+				suffixsort<uint32>::instance(text_eof, 12, jobs, std::cerr, opts) );
+		sorter->build_sa();
+		BOOST_CHECK( has_sa_equal(sorter->get_sa(), expected, 12) );
+
+		// Checkpoint of other input is rejected
+		std::unique_ptr< suffixsort<uint32> > other( 
+				suffixsort<uint32>::instance(text_eof + 7, 5, jobs, std::cerr, opts) );
+		BOOST_CHECK_THROW( other->build_sa(), std::runtime_error );
+
+		// Checkpoint of other input with the same length is rejected
+		const char changed_eof[12 + TextPadding] = "abracadabro";
+		std::unique_ptr< suffixsort<uint32> > changed( 
+				suffixsort<uint32>::instance(changed_eof, 12, jobs, std::cerr, opts) );
+		BOOST_CHECK_THROW( changed->build_sa(), std::runtime_error );
+		std::remove(opts.checkpoint.c_str());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( stats_report ) 
+{
+	const char text_eof[12 + TextPadding] = "abracadabra";
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		sortstats stats;
+		stats.set("input", "a\"b");
+		stats.set("length", (uint64)12);
+
+		sortopts opts;
+		opts.stats = &stats;
+		std::unique_ptr< suffixsort<uint32> > sorter( 
+				suffixsort<uint32>::instance(text_eof, 12, jobs, std::cerr, opts) );
+		sorter->build_sa();
+
+		std::ostringstream out;
+		stats.write_json(out);
+		const std::string json = out.str();
+		BOOST_CHECK( json.find("\"input\": \"a\\\"b\",") != std::string::npos );
+		BOOST_CHECK( json.find("\"length\": 12,") != std::string::npos );
+		BOOST_CHECK( json.find("{\"name\": \"init\"") != std::string::npos );
+		BOOST_CHECK( json.find("{\"name\": \"invert\"") != std::string::npos );
+
+		// Last round leaves only singleton groups
+		BOOST_CHECK( json.find("\"singletons\": 12, \"group_sizes\": [12]}\n  ]\n}") 
+				!= std::string::npos );
+	}
+
+	// Induced sorting has no rounds
+	sortstats stats;
+	sortopts opts;
+	opts.algorithm = AlgorithmInduced;
+	opts.stats = &stats;
+	std::unique_ptr< suffixsort<uint32> > sorter( 
+			suffixsort<uint32>::instance(text_eof, 12, 2, std::cerr, opts) );
+	sorter->build_sa();
+
+	std::ostringstream out;
+	stats.write_json(out);
+	BOOST_CHECK( out.str().find("{\"name\": \"induce\"") != std::string::npos );
+	BOOST_CHECK( out.str().find("\"rounds\": []") != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( batch_inputs ) 
+{
+	// test/batch/banana, test/batch/abracadabra
+	mkdir("test/batch", 0777);
+	write_byte_string("banana", 6, "test/batch/banana");
+	write_byte_string("abracadabra", 11, "test/batch/abracadabra");
+
+	std::vector<std::string> inputs = batchsort::list_inputs("test/batch");
+	BOOST_REQUIRE( inputs.size() == 2 );
+
+	sortopts opts;
+	opts.pooled = true;
+	batchopts bopts;
+	bopts.force = true;
+	batchsort batch(2, std::cerr, opts, bopts);
+	BOOST_CHECK( batch.run(inputs) == 0 );
+	BOOST_CHECK( batchsort::list_inputs("test/batch").size() == 2 );
+
+	const uint32 banana[7] = { 6, 5, 3, 1, 0, 4, 2 };
+	uint32 * sa = (uint32 *)read_byte_string("test/batch/banana.rank", 
+			sizeof(banana));
+	BOOST_CHECK( has_sa_equal(sa, banana, 7) );
+	delete [] sa;
+
+	const uint32 abracadabra[12] = { 11, 10, 7, 0, 3, 5, 8, 1, 4, 6, 9, 2 };
+	sa = (uint32 *)read_byte_string("test/batch/abracadabra.rank",
+			sizeof(abracadabra));
+	BOOST_CHECK( has_sa_equal(sa, abracadabra, 12) );
+	delete [] sa;
+
+	// Existing output is not overwritten without force
+	bopts.force = false;
+	batchsort again(2, std::cerr, opts, bopts);
+	BOOST_CHECK( again.run(inputs) == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( reuse_sorter ) 
+{
+	const uint32 banana[7] = { 6, 5, 3, 1, 0, 4, 2 };
+	const uint32 banana_lcp[7] = { 0, 0, 1, 3, 0, 0, 2 };
+	const uint32 abracadabra[12] = { 11, 10, 7, 0, 3, 5, 8, 1, 4, 6, 9, 2 };
+
+	for (uint32 jobs = 1 ; jobs <= 2 ; ++jobs) {
+		for (const char * algorithm : { AlgorithmDoubling, AlgorithmInduced }) {
+			sortopts opts;
+			opts.algorithm = algorithm;
+			sorter<uint32> s(jobs, opts);
+			BOOST_CHECK( has_sa_equal(s.sort("banana", 6), banana, 7) );
+			BOOST_CHECK( has_sa_equal(s.lcp(), banana_lcp, 7) );
+			BOOST_CHECK( has_sa_equal(s.sort("abracadabra", 11), 
+					abracadabra, 12) );
+			BOOST_CHECK( s.size() == 12 );
+			BOOST_CHECK( has_sa_equal(s.sort("banana", 6), banana, 7) );
+			BOOST_CHECK( has_sa_equal(s.lcp(), banana_lcp, 7) );
+		}
+	}
+
+	// C interface
+	tupla_sorter * c = tupla_sorter_new(2, "sais");
+	BOOST_REQUIRE( c != 0 );
+	const uint32_t * sa = 0;
+	const uint32_t * lcp = 0;
+	BOOST_CHECK( tupla_sort(c, "abracadabra", 11, &sa) == 0 );
+	BOOST_CHECK( has_sa_equal(sa, abracadabra, 12) );
+	BOOST_CHECK( tupla_sort(c, "banana", 6, &sa) == 0 );
+	BOOST_CHECK( has_sa_equal(sa, banana, 7) );
+	BOOST_CHECK( tupla_lcp(c, &lcp) == 0 );
+	BOOST_CHECK( has_sa_equal(lcp, banana_lcp, 7) );
+	tupla_sorter_free(c);
+	BOOST_CHECK( tupla_sorter_new(2, "bogus") == 0 );
+
+	// Sorter used from other threads frees its pooled arrays
+	const uint64 before = pooled_bytes();
+	{
+		sorter<uint32> s(2);
+		BOOST_CHECK( has_sa_equal(s.sort("banana", 6), banana, 7) );
+		const uint64 steady = pooled_bytes();
+		for (size_t i = 0 ; i < 2 ; ++i) {
+			boost::thread t( [&]() {
+				BOOST_CHECK( has_sa_equal(s.sort("abracadabra", 11),
+						abracadabra, 12) ); } );
+			t.join();
+		}
+		BOOST_CHECK( pooled_bytes() > before );
+
+		// Arrays and work arrays of later texts come from the pool
+		BOOST_CHECK( pooled_bytes() == steady );
+	}
+	BOOST_CHECK( pooled_bytes() == before );
+}
+
+BOOST_AUTO_TEST_CASE( schedule_tasks ) 
+{
+	for (uint32 jobs = 1 ; jobs <= 8 ; jobs <<= 1) {
+		scheduler sched(jobs);
+		test_sched = &sched;
+		size_t total = 0;
+		sched.schedule(&count_task, &total, 0, 100000);
+		sched.wait();
+		BOOST_CHECK( total == 100000 );
+
+		// Shares cover range exactly once
+		std::vector<size_t> shares(jobs * 2);
+		sched.parallel_for( [&](size_t p, size_t n, size_t j) {
+			shares[j] = n; }, 10, 1000, (1000 + (jobs * 2) - 1) / (jobs * 2) );
+		size_t covered = 0;
+		for (size_t n : shares) covered += n;
+		BOOST_CHECK( covered == 1000 );
+
+		// Placed shares run on their own worker in every loop
+		for (size_t round = 0 ; round < 3 ; ++round) {
+			std::vector<uint32> ran(jobs * 2, jobs);
+			sched.parallel_for( [&](size_t, size_t, size_t j) {
+				ran[j] = sched.worker(); }, 0, 1000,
+				(1000 + (jobs * 2) - 1) / (jobs * 2), true );
+			for (size_t j = 0 ; j < ran.size() ; ++j)
+				BOOST_CHECK( ran[j] == (j % jobs) );
+		}
+
+		// Other thread and other scheduler of same thread take place of
+		// worker 0
+		scheduler other(jobs);
+		for (scheduler * q : { &sched, &other }) {
+			boost::thread t( [&]() {
+				std::vector<uint32> ran(jobs * 2, jobs);
+				q->parallel_for( [&](size_t, size_t, size_t j) {
+					ran[j] = q->worker(); }, 0, 1000,
+					(1000 + (jobs * 2) - 1) / (jobs * 2), true );
+				for (size_t j = 0 ; j < ran.size() ; ++j)
+					BOOST_CHECK( ran[j] == (j % jobs) );
+			} );
+			t.join();
+			std::vector<uint32> ran(jobs * 2, jobs);
+			q->parallel_for( [&](size_t, size_t, size_t j) {
+				ran[j] = q->worker(); }, 0, 1000,
+				(1000 + (jobs * 2) - 1) / (jobs * 2), true );
+			for (size_t j = 0 ; j < ran.size() ; ++j)
+				BOOST_CHECK( ran[j] == (j % jobs) );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( numa_placement ) 
+{
+	// Interleaved array is usable and released like heap array
+	uint32 * data = alloc_array<uint32>(100000, std::string(), AllocInterleave);
+	for (size_t i = 0 ; i < 100000 ; ++i)
+		data[i] = i;
+	BOOST_CHECK( data[99999] == 99999 );
+	free_array(data);
+
+	// Huge pages or fallback to normal pages, all reported
+	for (uint32 flags = AllocHugePages ; flags <= 3 ; ++flags) {
+		data = alloc_array<uint32>((3 << 20), std::string(), flags);
+		memset(data, 1, ((3 << 20) * sizeof(uint32)));
+		BOOST_CHECK( describe_pages(data) != "heap pages" );
+		free_array(data);
+	}
+
+	// Pinned workers run all tasks, calling thread is not pinned
+	cpu_set_t cpus, pinned;
+	BOOST_REQUIRE( sched_getaffinity(0, sizeof(cpus), &cpus) == 0 );
+	{
+		scheduler sched(4, true);
+		test_sched = &sched;
+		size_t total = 0;
+		sched.schedule(&count_task, &total, 0, 10000);
+		sched.wait();
+		BOOST_CHECK( total == 10000 );
+		BOOST_REQUIRE( sched_getaffinity(0, sizeof(pinned), &pinned) == 0 );
+		BOOST_CHECK( CPU_EQUAL(&cpus, &pinned) );
+	}
+	BOOST_REQUIRE( sched_getaffinity(0, sizeof(pinned), &pinned) == 0 );
+	BOOST_CHECK( CPU_EQUAL(&cpus, &pinned) );
+}
+
 BOOST_AUTO_TEST_CASE( run_test_files_limited ) 
 {
 	for (auto filename : test_files) {
@@ -151,6 +693,52 @@ BOOST_AUTO_TEST_CASE( run_test_files_limited )
 	}
 }
 
+BOOST_AUTO_TEST_CASE( run_test_files_induced ) 
+{
+	for (auto filename : test_files) {
+		for (int jobs = 1 ; jobs <= 8 ; jobs <<= 1) {
+			std::cerr << "Running induced sorting test with '" << filename 
+					<< "' (1 MB) " << jobs << " threads" << std::endl;
+			run_sorter(filename, jobs, (1 << 20), AlgorithmInduced);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( run_test_files_gather ) 
+{
+	for (auto filename : test_files) {
+		for (int jobs = 1 ; jobs <= 8 ; jobs <<= 1) {
+			std::cerr << "Running gathered keys test with '" << filename 
+					<< "' (1 MB) " << jobs << " threads" << std::endl;
+			run_sorter(filename, jobs, (1 << 20), AlgorithmDoubling, true);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( run_test_files_wide ) 
+{
+	for (auto filename : test_files) {
+		for (int jobs = 1 ; jobs <= 8 ; jobs <<= 1) {
+			std::cerr << "Running 64-bit index test with '" << filename 
+					<< "' (1 MB) " << jobs << " threads" << std::endl;
+			run_sorter<uint64>(filename, jobs, (1 << 20));
+			run_sorter<uint64>(filename, jobs, (1 << 20), AlgorithmInduced);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( run_test_files_packed ) 
+{
+	for (auto filename : test_files) {
+		for (int jobs = 1 ; jobs <= 8 ; jobs <<= 1) {
+			std::cerr << "Running 40-bit index test with '" << filename 
+					<< "' (1 MB) " << jobs << " threads" << std::endl;
+			run_sorter<uint40>(filename, jobs, (1 << 20));
+			run_sorter<uint40>(filename, jobs, (1 << 20), AlgorithmInduced);
+		}
+	}
+}
+
 BOOST_AUTO_TEST_CASE( run_largetext ) 
 {
 	std::string filename("data/largetext/enwik8");